@@ -13,25 +13,42 @@ QMAKE_CXXFLAGS_RELEASE += -O2
 INCLUDEPATH += \
     src \
     src/input \
+    src/input/cursorlistener \
     src/input/inputsimulator \
     src/network \
     src/settings \
+    src/threadsettings \
+    src/wakeupnotifier \
     src/widgets
 
 SOURCES += \
     src/main.cpp \
+    src/monotonicclock.cpp \
     src/opensslwrapper.cpp \
     src/input/clipboardhandler.cpp \
     src/input/cursorhandler.cpp \
+    src/input/cursorlistener/cursorlistenerlinux.cpp \
+    src/input/cursorlistener/cursorlistenerwindows.cpp \
     src/input/inputhandler.cpp \
+    src/input/inputsimulator/inputsimulator.cpp \
     src/input/inputsimulator/inputsimulatorlinux.cpp \
     src/input/inputsimulator/inputsimulatorwindows.cpp \
+    src/input/motionplayout.cpp \
+    src/input/transitindex.cpp \
     src/network/broadcastdevicesearch.cpp \
     src/network/deviceconnectmanager.cpp \
+    src/network/framepool.cpp \
+    src/network/message.cpp \
     src/network/tcpserver.cpp \
     src/network/tcpsocket.cpp \
+    src/settings/devicetable.cpp \
     src/settings/jsonloader.cpp \
     src/settings/settingsfacade.cpp \
+    src/threadsettings/threadsettings.cpp \
+    src/threadsettings/threadsettingslinux.cpp \
+    src/threadsettings/threadsettingswindows.cpp \
+    src/wakeupnotifier/wakeupnotifierlinux.cpp \
+    src/wakeupnotifier/wakeupnotifierwindows.cpp \
     src/widgets/deviceitemwidget.cpp \
     src/widgets/screenpositionwidget.cpp \
     src/widgets/screenrectitem.cpp \
@@ -41,17 +58,27 @@ SOURCES += \
 HEADERS += \
     src/global.h \
     src/utils.h \
+    src/monotonicclock.h \
+    src/spscqueue.h \
     src/opensslwrapper.h \
     src/input/clipboardhandler.h \
     src/input/cursorhandler.h \
+    src/input/cursorlistener/cursorlistener.h \
     src/input/inputhandler.h \
     src/input/inputsimulator/inputsimulator.h \
+    src/input/motionplayout.h \
+    src/input/transitindex.h \
     src/network/deviceconnectmanager.h \
+    src/network/framepool.h \
+    src/network/message.h \
     src/network/broadcastdevicesearch.h \
     src/network/tcpserver.h \
     src/network/tcpsocket.h \
+    src/settings/devicetable.h \
     src/settings/jsonloader.h \
     src/settings/settingsfacade.h \
+    src/threadsettings/threadsettings.h \
+    src/wakeupnotifier/wakeupnotifier.h \
     src/widgets/deviceitemwidget.h \
     src/widgets/screenpositionwidget.h \
     src/widgets/screenrectitem.h \
@@ -78,5 +105,5 @@ win32 {
 }
 
 linux:!android {
-    LIBS += -lX11 -lXtst -lcrypto
+    LIBS += -lX11 -lXtst -lXi -lXfixes -lXrandr -lcrypto
 }
@@ -0,0 +1,189 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+
+#include "wakeupnotifier.h"
+#include "opensslwrapper.h"
+#include "framepool.h"
+#include "spscqueue.h"
+#include "message.h"
+
+// counts every heap allocation of the process, Qt containers and OpenSSL call malloc
+// directly, operator new ends up here as well
+static std::atomic<bool> counting{false};
+static std::atomic<quint64> allocations{0};
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    if (counting.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (counting.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    if (counting.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+static const int WARMUP = 1000;
+static const int ITERATIONS = 100000;
+
+static SharedCursor::Message motionMessage(int i)
+{
+    SharedCursor::Message message;
+    message.type = SharedCursor::Message::CursorDelta;
+    message.point = QPoint(i % 7 - 3, i % 5 - 2);
+    return message;
+}
+
+// runs the step uncounted first so lazily grown buffers are in place, then counts
+template <typename Step>
+static void measure(const char *name, Step step)
+{
+    for (int i=0; i<WARMUP; ++i) {
+        step(i);
+    }
+
+    QElapsedTimer timer;
+    allocations = 0;
+    counting = true;
+    timer.start();
+
+    for (int i=0; i<ITERATIONS; ++i) {
+        step(i);
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    counting = false;
+
+    std::printf("%-32s %10.3f allocations/event %10.1f ns/event\n", name,
+                double(allocations) / ITERATIONS, double(elapsed) / ITERATIONS);
+}
+
+// the receiving end of both handoffs, lives on its own thread
+class Consumer : public QObject
+{
+    Q_OBJECT
+public:
+    SpscQueue<SharedCursor::Message, 256> queue;
+    WakeupNotifier notifier{this};
+    std::atomic<quint64> received{0};
+
+public slots:
+    void start()
+    {
+        connect(&notifier, &WakeupNotifier::activated, this, &Consumer::drain);
+        notifier.start();
+    }
+
+    void drain()
+    {
+        SharedCursor::Message message;
+        while (queue.pop(message)) {
+            received.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void receive(const SharedCursor::Message &message)
+    {
+        Q_UNUSED(message);
+        received.fetch_add(1, std::memory_order_release);
+    }
+};
+
+class Producer : public QObject
+{
+    Q_OBJECT
+signals:
+    void message(const SharedCursor::Message &message);
+};
+
+// every event waits for the consumer, so each one pays a full wakeup
+static void waitReceived(const Consumer &consumer, quint64 count)
+{
+    while (consumer.received.load(std::memory_order_acquire) < count) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    qRegisterMetaType<SharedCursor::Message>("SharedCursor::Message");
+
+    std::printf("%d events per case after %d warmup events\n", ITERATIONS, WARMUP);
+
+    char buffer[SharedCursor::MAX_BINARY_MESSAGE_SIZE];
+    SharedCursor::Message decoded;
+    measure("binary encode+decode", [&](int i) {
+        const int size = SharedCursor::encodeBinary(motionMessage(i), buffer);
+        SharedCursor::decodeBinary(buffer, size, decoded);
+    });
+
+    QJsonObject json;
+    measure("json encode (relay only)", [&](int i) {
+        SharedCursor::encodeJson(motionMessage(i), json);
+    });
+
+    OpenSslWrapper wrapper;
+    wrapper.setKey("benchmark");
+    char encrypted[SharedCursor::MAX_BINARY_MESSAGE_SIZE + 16];
+    char plain[SharedCursor::MAX_BINARY_MESSAGE_SIZE + 16];
+    measure("frame encrypt+decrypt", [&](int i) {
+        const int size = SharedCursor::encodeBinary(motionMessage(i), buffer);
+        const int length = wrapper.encrypt(buffer, size, encrypted, sizeof(encrypted));
+        wrapper.decrypt(encrypted, length, plain, sizeof(plain));
+    });
+
+    measure("frame pool acquire+release", [&](int i) {
+        FramePool::Frame frame = FramePool::local().acquire(48 + i % 16);
+        frame.data()[0] = 0;
+    });
+
+    QThread thread;
+    Consumer consumer;
+    Producer producer;
+    consumer.moveToThread(&thread);
+    QObject::connect(&thread, &QThread::started, &consumer, &Consumer::start);
+    QObject::connect(&thread, &QThread::finished, &consumer.notifier, &WakeupNotifier::stop);
+    QObject::connect(&producer, &Producer::message, &consumer, &Consumer::receive, Qt::QueuedConnection);
+    thread.start();
+    QThread::msleep(100);
+
+    quint64 sent = 0;
+    measure("handoff spsc+wakeup", [&](int i) {
+        while (!consumer.queue.push(motionMessage(i))) {
+            QThread::yieldCurrentThread();
+        }
+        consumer.notifier.wakeUp();
+        waitReceived(consumer, ++sent);
+    });
+
+    measure("handoff queued signal (before)", [&](int i) {
+        emit producer.message(motionMessage(i));
+        waitReceived(consumer, ++sent);
+    });
+
+    thread.quit();
+    thread.wait();
+
+    return 0;
+}
+
+#include "main.moc"
@@ -0,0 +1,35 @@
+QT += core network
+QT -= gui
+
+CONFIG += c++17
+CONFIG += console
+
+TEMPLATE = app
+TARGET = motionalloc
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += \
+    ../../src \
+    ../../src/network \
+    ../../src/settings \
+    ../../src/wakeupnotifier
+
+SOURCES += \
+    main.cpp \
+    ../../src/opensslwrapper.cpp \
+    ../../src/network/framepool.cpp \
+    ../../src/network/message.cpp \
+    ../../src/wakeupnotifier/wakeupnotifierlinux.cpp
+
+HEADERS += \
+    ../../src/spscqueue.h \
+    ../../src/opensslwrapper.h \
+    ../../src/network/framepool.h \
+    ../../src/network/message.h \
+    ../../src/wakeupnotifier/wakeupnotifier.h
+
+# the allocation counter interposes the glibc allocator, linux only
+linux:!android {
+    LIBS += -lcrypto
+}
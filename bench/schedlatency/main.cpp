@@ -0,0 +1,115 @@
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "threadsettings.h"
+#include "global.h"
+
+static const int SAMPLES = 5000;
+static const int LOAD_THREADS_PER_CPU = 2;
+static const std::chrono::microseconds PERIOD(1000);
+
+// a thread with the given settings that wakes up every PERIOD and records how late it was,
+// the way the capture thread waits for its next poll
+class Probe : public QThread
+{
+public:
+    explicit Probe(const QJsonObject &settings)
+    {
+        _settings.load(settings);
+    }
+
+    QString report;
+    std::vector<qint64> lateness;
+
+protected:
+    void run() override
+    {
+        report = _settings.apply();
+        lateness.reserve(SAMPLES);
+
+        auto next = std::chrono::steady_clock::now();
+        for (int i=0; i<SAMPLES; ++i) {
+            next += PERIOD;
+            std::this_thread::sleep_until(next);
+            lateness.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - next).count());
+        }
+    }
+
+private:
+    ThreadSettings _settings;
+};
+
+// busy threads at default priority on every cpu, like a build running next to the session
+class Load
+{
+public:
+    explicit Load(int threads)
+    {
+        for (int i=0; i<threads; ++i) {
+            _threads.emplace_back([this]() {
+                volatile quint64 counter = 0;
+                while (_running.load(std::memory_order_relaxed)) {
+                    ++counter;
+                }
+            });
+        }
+    }
+
+    ~Load()
+    {
+        _running = false;
+        for (std::thread &thread: _threads) {
+            thread.join();
+        }
+    }
+
+private:
+    std::atomic<bool> _running{true};
+    std::vector<std::thread> _threads;
+};
+
+static void measure(const char *name, const QJsonObject &settings)
+{
+    Probe probe(settings);
+    probe.start();
+    probe.wait();
+
+    std::vector<qint64> &lateness = probe.lateness;
+    std::sort(lateness.begin(), lateness.end());
+
+    std::printf("%-28s p50 %6lld us  p99 %6lld us  max %6lld us  (%s)\n", name,
+                lateness[lateness.size() / 2], lateness[lateness.size() * 99 / 100], lateness.back(),
+                qPrintable(probe.report));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    const QJsonObject defaults;
+    const QJsonObject timeCritical{{SharedCursor::KEY_PRIORITY, "timeCritical"}};
+    const QJsonObject fifo{{SharedCursor::KEY_POLICY, "fifo"}, {SharedCursor::KEY_REALTIME_PRIORITY, 10}};
+    const QJsonObject fifoPinned{{SharedCursor::KEY_POLICY, "fifo"}, {SharedCursor::KEY_REALTIME_PRIORITY, 10},
+                                 {SharedCursor::KEY_CPUS, QJsonArray{0}}};
+
+    const int loadThreads = QThread::idealThreadCount() * LOAD_THREADS_PER_CPU;
+    std::printf("%d wakeups every %lld us, %d load threads\n", SAMPLES, qint64(PERIOD.count()), loadThreads);
+
+    measure("idle, defaults", defaults);
+
+    Load load(loadThreads);
+    measure("load, defaults", defaults);
+    measure("load, timeCritical", timeCritical);
+    measure("load, fifo 10", fifo);
+    measure("load, fifo 10 on cpu 0", fifoPinned);
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+QT += core network
+QT -= gui
+
+CONFIG += c++17
+CONFIG += console
+
+TEMPLATE = app
+TARGET = schedlatency
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += \
+    ../../src \
+    ../../src/threadsettings
+
+SOURCES += \
+    main.cpp \
+    ../../src/threadsettings/threadsettings.cpp \
+    ../../src/threadsettings/threadsettingslinux.cpp \
+    ../../src/threadsettings/threadsettingswindows.cpp
+
+HEADERS += \
+    ../../src/global.h \
+    ../../src/threadsettings/threadsettings.h
@@ -0,0 +1,178 @@
+#include <QElapsedTimer>
+#include <QVector>
+#include <cstdio>
+#include <random>
+
+#include "transitindex.h"
+#include "global.h"
+
+static const int COLUMNS = 16;
+static const int ROWS = 16;
+static const int SCREEN_WIDTH = 1920;
+static const int SCREEN_HEIGHT = 1080;
+static const int QUERIES = 100000;
+static const int ROUNDS = 20;
+static const int MAX_MOTION = 40;
+static const int NEAR_TRANSIT_DISTANCE = 100;
+
+// a grid of screens with a transit on every shared edge, leading to the neighbour
+static void buildLayout(QVector<SharedCursor::Screen> &screens, QVector<SharedCursor::Transit> &transits)
+{
+    for (int row=0; row<ROWS; ++row) {
+        for (int column=0; column<COLUMNS; ++column) {
+            SharedCursor::Screen screen;
+            screen.rect = QRect(column * SCREEN_WIDTH, row * SCREEN_HEIGHT, SCREEN_WIDTH, SCREEN_HEIGHT);
+            screens.append(screen);
+
+            if (column + 1 < COLUMNS) {
+                SharedCursor::Transit transit;
+                transit.line = QLine(screen.rect.right(), screen.rect.top(), screen.rect.right(), screen.rect.bottom());
+                transit.pos = QPoint(screen.rect.right() + 1, screen.rect.top());
+                transit.handle = transits.size();
+                transits.append(transit);
+            }
+
+            if (row + 1 < ROWS) {
+                SharedCursor::Transit transit;
+                transit.line = QLine(screen.rect.left(), screen.rect.bottom(), screen.rect.right(), screen.rect.bottom());
+                transit.pos = QPoint(screen.rect.left(), screen.rect.bottom() + 1);
+                transit.handle = transits.size();
+                transits.append(transit);
+            }
+        }
+    }
+}
+
+// the scans checkCursor used to run over every transit, on the same boundaries
+static const SharedCursor::Transit *linearTransitAt(const QVector<TransitIndex::Boundary> &boundaries, const QPoint &pos)
+{
+    for (const TransitIndex::Boundary &boundary: boundaries) {
+        const QLine &line = boundary.line;
+        if (line.x1() <= pos.x() && line.x2() >= pos.x() &&
+            line.y1() <= pos.y() && line.y2() >= pos.y())
+            return boundary.transit;
+    }
+
+    return nullptr;
+}
+
+static const SharedCursor::Transit *linearTransitCrossed(const QVector<TransitIndex::Boundary> &boundaries,
+                                                          const QPoint &from, const QPoint &to)
+{
+    const SharedCursor::Transit *result = nullptr;
+    int distance = 0;
+
+    for (const TransitIndex::Boundary &boundary: boundaries) {
+        const QLine &line = boundary.line;
+        const bool vertical = line.x1() == line.x2();
+        const int coord = vertical ? line.x1() : line.y1();
+        const int start = vertical ? line.y1() : line.x1();
+        const int end = vertical ? line.y2() : line.x2();
+        const int fromCoord = vertical ? from.x() : from.y();
+        const int toCoord = vertical ? to.x() : to.y();
+        const int fromValue = vertical ? from.y() : from.x();
+        const int toValue = vertical ? to.y() : to.x();
+
+        if (fromCoord == toCoord || boundary.direction == 0)
+            continue;
+
+        if (boundary.direction > 0 && !(fromCoord < coord && toCoord >= coord))
+            continue;
+
+        if (boundary.direction < 0 && !(fromCoord > coord && toCoord <= coord))
+            continue;
+
+        const qreal value = fromValue + qreal(toValue - fromValue) * (coord - fromCoord) / (toCoord - fromCoord);
+        if (value < start || value > end)
+            continue;
+
+        if (result && qAbs(coord - fromCoord) >= distance)
+            continue;
+
+        result = boundary.transit;
+        distance = qAbs(coord - fromCoord);
+    }
+
+    return result;
+}
+
+static bool linearIsNearTransit(const QVector<TransitIndex::Boundary> &boundaries, const QPoint &pos)
+{
+    for (const TransitIndex::Boundary &boundary: boundaries) {
+        const QLine &line = boundary.line;
+        const int dx = qMax(qMax(line.x1() - pos.x(), pos.x() - line.x2()), 0);
+        const int dy = qMax(qMax(line.y1() - pos.y(), pos.y() - line.y2()), 0);
+
+        // the distance across the edge counts inclusive like in the index
+        if (line.x1() == line.x2() ? dx <= NEAR_TRANSIT_DISTANCE && dy < NEAR_TRANSIT_DISTANCE
+                                   : dx < NEAR_TRANSIT_DISTANCE && dy <= NEAR_TRANSIT_DISTANCE)
+            return true;
+    }
+
+    return false;
+}
+
+// runs every query ROUNDS times, the hit count guards against dead code and compares both sides
+template <typename Query>
+static void measure(const char *name, Query query)
+{
+    int hits = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int round=0; round<ROUNDS; ++round) {
+        hits = 0;
+        for (int i=0; i<QUERIES; ++i) {
+            hits += query(i) ? 1 : 0;
+        }
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+    std::printf("%-28s %10.1f ns/query %8d hits\n", name, double(elapsed) / (qint64(QUERIES) * ROUNDS), hits);
+}
+
+int main()
+{
+    QVector<SharedCursor::Screen> screens;
+    QVector<SharedCursor::Transit> transits;
+    buildLayout(screens, transits);
+
+    TransitIndex index;
+    index.build(transits, screens);
+    const QVector<TransitIndex::Boundary> boundaries = index.boundaries();
+
+    // every other query lies on a transit, motion starts next to it and may cross it
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> xs(0, COLUMNS * SCREEN_WIDTH - 1);
+    std::uniform_int_distribution<int> ys(0, ROWS * SCREEN_HEIGHT - 1);
+    std::uniform_int_distribution<int> motion(-MAX_MOTION, MAX_MOTION);
+    std::uniform_int_distribution<int> pick(0, transits.size() - 1);
+
+    QVector<QPoint> positions;
+    QVector<QPoint> targets;
+
+    for (int i=0; i<QUERIES; ++i) {
+        QPoint pos(xs(random), ys(random));
+
+        if (i % 2) {
+            const QLine &line = transits.at(pick(random)).line;
+            pos = line.x1() == line.x2() ? QPoint(line.x1(), qBound(line.y1(), pos.y(), line.y2()))
+                                         : QPoint(qBound(line.x1(), pos.x(), line.x2()), line.y1());
+        }
+
+        positions.append(pos);
+        targets.append(pos + QPoint(motion(random), motion(random)));
+    }
+
+    std::printf("%d screens, %d transits, %d queries x %d rounds\n", screens.size(), transits.size(), QUERIES, ROUNDS);
+
+    QPoint crossPos;
+    measure("transitAt index", [&](int i) { return index.transitAt(positions.at(i)); });
+    measure("transitAt linear", [&](int i) { return linearTransitAt(boundaries, positions.at(i)); });
+    measure("transitCrossed index", [&](int i) { return index.transitCrossed(targets.at(i), positions.at(i), crossPos); });
+    measure("transitCrossed linear", [&](int i) { return linearTransitCrossed(boundaries, targets.at(i), positions.at(i)); });
+    measure("isNearTransit index", [&](int i) { return index.isNearTransit(targets.at(i), NEAR_TRANSIT_DISTANCE); });
+    measure("isNearTransit linear", [&](int i) { return linearIsNearTransit(boundaries, targets.at(i)); });
+
+    return 0;
+}
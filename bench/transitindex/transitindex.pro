@@ -0,0 +1,22 @@
+QT += core network
+QT -= gui
+
+CONFIG += c++17
+CONFIG += console
+
+TEMPLATE = app
+TARGET = transitindex
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += \
+    ../../src \
+    ../../src/input
+
+SOURCES += \
+    main.cpp \
+    ../../src/input/transitindex.cpp
+
+HEADERS += \
+    ../../src/global.h \
+    ../../src/input/transitindex.h
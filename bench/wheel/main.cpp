@@ -0,0 +1,175 @@
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <cstdio>
+
+#include "inputsimulator.h"
+#include "xvfbserver.h"
+#include "global.h"
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/XTest.h>
+#include <poll.h>
+
+static const int NOTCHES = 20000;
+static const int BATCH = 8;
+static const int TIMEOUT = 30000;
+
+// counts the wheel presses the server delivered, raw events arrive once per master device
+class WheelObserver
+{
+public:
+    ~WheelObserver()
+    {
+        if (_display)
+            XCloseDisplay(_display);
+    }
+
+    bool start()
+    {
+        _display = XOpenDisplay(nullptr);
+        if (!_display)
+            return false;
+
+        int event = 0, error = 0;
+        if (!XQueryExtension(_display, "XInputExtension", &_xiOpcode, &event, &error))
+            return false;
+
+        int major = 2, minor = 2;
+        if (XIQueryVersion(_display, &major, &minor) != Success)
+            return false;
+
+        unsigned char mask[XIMaskLen(XI_LASTEVENT)] = {0};
+        XISetMask(mask, XI_RawButtonPress);
+
+        XIEventMask eventMask;
+        eventMask.deviceid = XIAllMasterDevices;
+        eventMask.mask_len = sizeof(mask);
+        eventMask.mask = mask;
+
+        XISelectEvents(_display, DefaultRootWindow(_display), &eventMask, 1);
+        XSync(_display, False);
+        return true;
+    }
+
+    // false when the server did not deliver all presses in time
+    bool wait(int count)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        while (_presses < count) {
+            if (!XPending(_display)) {
+                if (timer.elapsed() > TIMEOUT)
+                    return false;
+
+                pollfd fd = {ConnectionNumber(_display), POLLIN, 0};
+                poll(&fd, 1, 100);
+                continue;
+            }
+
+            XEvent event;
+            XNextEvent(_display, &event);
+
+            XGenericEventCookie *cookie = &event.xcookie;
+            if (cookie->type != GenericEvent || cookie->extension != _xiOpcode || !XGetEventData(_display, cookie))
+                continue;
+
+            const XIRawEvent *raw = static_cast<const XIRawEvent*>(cookie->data);
+            if (cookie->evtype == XI_RawButtonPress && raw->detail >= 4 && raw->detail <= 7)
+                ++_presses;
+
+            XFreeEventData(_display, cookie);
+        }
+
+        _presses -= count;
+        return true;
+    }
+
+private:
+    Display *_display = nullptr;
+    int _xiOpcode = 0;
+    int _presses = 0;
+};
+
+// the time from the first call until the server delivered every notch
+template <typename Inject>
+static void measure(const char *name, WheelObserver &observer, int calls, int notchesPerCall, Inject inject)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i=0; i<calls; ++i) {
+        inject(i);
+    }
+
+    const bool delivered = observer.wait(calls * notchesPerCall);
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    if (!delivered) {
+        std::printf("%-36s timed out\n", name);
+        return;
+    }
+
+    std::printf("%-36s %12.0f notches/s %10.2f us/notch\n", name,
+                double(calls) * notchesPerCall * 1e9 / elapsed, double(elapsed) / 1000 / (qint64(calls) * notchesPerCall));
+}
+
+// what setWheelEvent did before the persistent display, one connection per notch
+static void injectOwnConnection(bool up)
+{
+    Display *display = XOpenDisplay(nullptr);
+    if (!display)
+        return;
+
+    const unsigned int button = up ? Button4 : Button5;
+    XTestFakeButtonEvent(display, button, true, 0);
+    XTestFakeButtonEvent(display, button, false, 0);
+
+    XFlush(display);
+    XCloseDisplay(display);
+}
+
+int main(int argc, char *argv[])
+{
+    // qt itself stays off the server, only the injection and the observer talk to it
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication a(argc, argv);
+
+    XvfbServer xvfb;
+    if (!xvfb.start()) {
+        std::printf("Xvfb is not available\n");
+        return 1;
+    }
+
+    WheelObserver observer;
+    if (!observer.start()) {
+        std::printf("XInput 2.2 is not available\n");
+        return 1;
+    }
+
+    InputSimulator simulator;
+    simulator.start();
+    simulator.setControlState(SharedCursor::Slave);
+
+    std::printf("%d notches per case\n", NOTCHES);
+
+    measure("persistent display, notch per call", observer, NOTCHES, 1, [&](int i) {
+        simulator.setWheelEvent(i % 2 ? SharedCursor::WHEEL_STEP : -SharedCursor::WHEEL_STEP, 0);
+    });
+
+    measure("persistent display, batched", observer, NOTCHES / BATCH, BATCH, [&](int i) {
+        simulator.setWheelEvent(i % 2 ? BATCH * SharedCursor::WHEEL_STEP : -BATCH * SharedCursor::WHEEL_STEP, 0);
+    });
+
+    measure("persistent display, horizontal", observer, NOTCHES, 1, [&](int i) {
+        simulator.setWheelEvent(0, i % 2 ? SharedCursor::WHEEL_STEP : -SharedCursor::WHEEL_STEP);
+    });
+
+    measure("connection per notch (before)", observer, NOTCHES, 1, [&](int i) {
+        injectOwnConnection(i % 2);
+    });
+
+    simulator.stop();
+    return 0;
+}
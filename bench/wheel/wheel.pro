@@ -0,0 +1,33 @@
+QT += core gui network
+
+CONFIG += c++17
+CONFIG += console
+
+TEMPLATE = app
+TARGET = wheel
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += \
+    ../../tests/common \
+    ../../src \
+    ../../src/input/inputsimulator \
+    ../../src/settings \
+    ../../src/wakeupnotifier
+
+SOURCES += \
+    main.cpp \
+    ../../src/monotonicclock.cpp \
+    ../../src/input/inputsimulator/inputsimulator.cpp \
+    ../../src/input/inputsimulator/inputsimulatorlinux.cpp \
+    ../../src/wakeupnotifier/wakeupnotifierlinux.cpp
+
+HEADERS += \
+    ../../tests/common/xvfbserver.h \
+    ../../src/monotonicclock.h \
+    ../../src/input/inputsimulator/inputsimulator.h \
+    ../../src/wakeupnotifier/wakeupnotifier.h
+
+linux:!android {
+    LIBS += -lX11 -lXtst -lXi -lXrandr
+}
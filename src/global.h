@@ -6,6 +6,7 @@
 #include <QLine>
 #include <QUuid>
 #include <QRect>
+#include <algorithm>
 
 namespace SharedCursor
 {
@@ -41,18 +42,57 @@ namespace SharedCursor
     inline const char* KEY_CURSOR_POS = "cursorPos";
     inline const char* KEY_INIT_CURSOR_POS = "initCursorPos";
     inline const char* KEY_REMOTE_CONTROL = "remoteControl";
+    inline const char* KEY_EDGES = "edges";
+    inline const char* KEY_CROSSED_EDGE = "crossedEdge";
     inline const char* KEY_INPUT = "input";
     inline const char* KEY_MOUSE = "mouse";
     inline const char* KEY_KEYBOARD = "keyboard";
     inline const char* KEY_WHEEL = "wheel";
+    inline const char* KEY_HORIZONTAL = "horizontal";
     inline const char* KEY_PRESSED = "pressed";
     inline const char* KEY_MASTER = "master";
     inline const char* KEY_SLAVE = "slave";
     inline const char* KEY_CLIPBOARD = "clipboard";
+    inline const char* KEY_LAYOUT_HASH = "layoutHash";
+    inline const char* KEY_DEVICE_INFO = "deviceInfo";
+    inline const char* KEY_DEVICE_INFO_REQUEST = "deviceInfoRequest";
+    inline const char* KEY_RELAY = "relay";
+    inline const char* KEY_ROUTES = "routes";
+    inline const char* KEY_SOURCE = "source";
+    inline const char* KEY_TARGET = "target";
+    inline const char* KEY_HOPS = "hops";
+    inline const char* KEY_LATENCY = "latency";
+    inline const char* KEY_PING = "ping";
+    inline const char* KEY_PONG = "pong";
+    inline const char* KEY_TIME = "time";
+    inline const char* KEY_MOTION_PLAYOUT = "motionPlayout";
+    inline const char* KEY_THREADS = "threads";
+    inline const char* KEY_CAPTURE = "capture";
+    inline const char* KEY_NETWORK = "network";
+    inline const char* KEY_INJECTION = "injection";
+    inline const char* KEY_PRIORITY = "priority";
+    inline const char* KEY_POLICY = "policy";
+    inline const char* KEY_REALTIME_PRIORITY = "realtimePriority";
+    inline const char* KEY_CPUS = "cpus";
+    inline const char* KEY_STALL_DEADLINE = "stallDeadline";
+    inline const char* KEY_STATS_INTERVAL = "statsInterval";
+    inline const char* KEY_MOTION_BACKLOG_LIMIT = "motionBacklogLimit";
 
     inline const quint16 DEFAULT_TCP_PORT = 25786;
     inline const quint16 DEFAULT_UDP_PORT = 25787;
     inline const quint16 CONNECT_INTERVAL = 10000;
+    inline const quint8 DISCOVERY_VERSION = 1;
+    inline const quint16 ROUTE_UPDATE_INTERVAL = 1000;
+    inline const int MAX_RELAY_HOPS = 4;
+    // cursor deltas are sent in 1/SUBPIXEL_SCALE pixel units
+    inline const int SUBPIXEL_SCALE = 256;
+    inline const int DEFAULT_DPI = 96;
+    inline const int WHEEL_STEP = 120;
+    // a controlled device silent for longer is treated as stalled, msec
+    inline const int DEFAULT_STALL_DEADLINE = 300;
+    inline const int DEFAULT_STATS_INTERVAL = 10000;
+    // unacknowledged motion bytes before motion is merged, about 50 frames
+    inline const int DEFAULT_MOTION_BACKLOG_LIMIT = 1024;
 
     enum ConnectionState {
         Unknown = 0,
@@ -91,12 +131,14 @@ namespace SharedCursor
         QLine line;
         QPoint pos;
         QUuid uuid;
+        int handle = -1;
     };
 
     struct Screen
     {
         bool enabled = true;
         QRect rect;
+        int dpi = DEFAULT_DPI;
     };
 
     struct Device
@@ -108,9 +150,50 @@ namespace SharedCursor
         QPoint position;
         QVector<Screen> screens;
         QVector<Transit> transits;
+        quint32 layoutHash = 0;
 
         ConnectionState state = Disconnected;
     };
 
     inline bool operator==(const Device &d1, const Device &d2) { return d1.uuid == d2.uuid; }
+
+    // read only copy of the layout handed to other threads, never changed after publishing
+    struct Topology
+    {
+        struct Entry
+        {
+            QUuid uuid;
+            int handle = -1;
+            int firstScreen = 0;
+            int screenCount = 0;
+            int firstTransit = 0;
+            int transitCount = 0;
+        };
+
+        quint64 version = 0;
+        QVector<Entry> devices;
+        QVector<Screen> screens;
+        QVector<Transit> transits;
+        QVector<int> indexByHandle;
+
+        int indexOf(const QUuid &uuid) const {
+            auto it = std::lower_bound(devices.begin(), devices.end(), uuid,
+                                       [](const Entry &entry, const QUuid &value) { return entry.uuid < value; });
+            return it != devices.end() && it->uuid == uuid ? int(it - devices.begin()) : -1;
+        }
+
+        int indexOfHandle(int handle) const {
+            return handle >= 0 && handle < indexByHandle.size() ? indexByHandle.at(handle) : -1;
+        }
+
+        QVector<Screen> screensOf(int index) const {
+            return screens.mid(devices.at(index).firstScreen, devices.at(index).screenCount);
+        }
+
+        QVector<Transit> transitsOf(int index) const {
+            return transits.mid(devices.at(index).firstTransit, devices.at(index).transitCount);
+        }
+    };
+
+    using TopologySnapshot = QSharedPointer<const Topology>;
 };
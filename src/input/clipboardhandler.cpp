@@ -4,6 +4,7 @@
 #include <QDebug>
 
 #include "clipboardhandler.h"
+#include "devicetable.h"
 #include "global.h"
 
 ClipboardHandler::ClipboardHandler(QObject *parent)
@@ -23,8 +24,9 @@ void ClipboardHandler::setCurrentUuid(const QUuid &uuid)
 
 void ClipboardHandler::setRemoteControlState(const QUuid &master, const QUuid &slave)
 {
-    if (slave != _uuidOwn && !_clipboardHolders.contains(slave)) {
-        _clipboardHolders.insert(slave, false);
+    const int handle = DeviceTable::handle(slave);
+    if (slave != _uuidOwn && handle >= 0 && holderState(handle) == NotHolder) {
+        holderState(handle) = Outdated;
     }
 
     if (_uuidSlave != slave && _uuidSlave == _uuidOwn) {
@@ -41,9 +43,9 @@ void ClipboardHandler::setClipboard(const QUuid &uuid, const QJsonObject &json)
 {
     _applyingClipboard = true;
 
-    auto it = _clipboardHolders.find(uuid);
-    if (it != _clipboardHolders.end()) {
-        it.value() = true;
+    const int handle = DeviceTable::handle(uuid);
+    if (handle >= 0 && holderState(handle) != NotHolder) {
+        holderState(handle) = Current;
     }
 
     const QString &text = json.value(SharedCursor::KEY_VALUE).toString();
@@ -65,17 +67,25 @@ void ClipboardHandler::onClipboardChanged()
         return;
     }
 
-    for (auto it = _clipboardHolders.begin(); it != _clipboardHolders.end(); ++it) {
-        it.value() = false;
+    for (HolderState &state: _clipboardHolders) {
+        if (state == Current)
+            state = Outdated;
     }
 }
 
 void ClipboardHandler::sendClipboard(const QUuid &uuid)
 {
-    auto it = _clipboardHolders.find(uuid);
-    if (it != _clipboardHolders.end() && !it.value()) {
+    const int handle = DeviceTable::handle(uuid);
+    if (handle >= 0 && holderState(handle) == Outdated) {
         _jsonMessage[SharedCursor::KEY_VALUE] = QApplication::clipboard()->mimeData()->text();
         emit message(uuid, _jsonMessage);
-        it.value() = true;
+        holderState(handle) = Current;
     }
 }
+
+ClipboardHandler::HolderState &ClipboardHandler::holderState(int handle)
+{
+    if (_clipboardHolders.size() <= handle)
+        _clipboardHolders.resize(handle + 1);
+    return _clipboardHolders[handle];
+}
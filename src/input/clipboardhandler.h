@@ -2,7 +2,7 @@
 
 #include <QJsonObject>
 #include <QObject>
-#include <QMap>
+#include <QVector>
 
 class ClipboardHandler : public QObject
 {
@@ -22,10 +22,18 @@ signals:
     void message(const QUuid &uuid, const QJsonObject &json);
 
 private:
+    enum HolderState {
+        NotHolder = 0,
+        Outdated,
+        Current
+    };
+
     QUuid _uuidOwn, _uuidMaster, _uuidSlave;
-    QMap<QUuid, bool> _clipboardHolders;
+    // indexed by device handle
+    QVector<HolderState> _clipboardHolders;
     QJsonObject _jsonMessage;
     bool _applyingClipboard = false;
 
     void sendClipboard(const QUuid &uuid);
+    HolderState &holderState(int handle);
 };
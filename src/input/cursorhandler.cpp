@@ -3,10 +3,22 @@
 #include <QCursor>
 #include <qmath.h>
 
+#include "monotonicclock.h"
 #include "cursorhandler.h"
+#include "devicetable.h"
 #include "utils.h"
 
-static const int UPDATE_INTERVAL = 18;
+static const int FAST_UPDATE_INTERVAL = 4;
+static const int IDLE_UPDATE_INTERVAL = 100;
+static const int LISTENER_UPDATE_INTERVAL = 250;
+static const int PRECISE_TIMER_LIMIT = 20;
+static const int IDLE_TIMEOUT = 500;
+static const int NEAR_TRANSIT_DISTANCE = 100;
+// the slave takes control back after local motion lasting this long while the master is quiet
+static const qint64 REMOTE_QUIET_TIME = 1000;
+static const qint64 LOCAL_MOTION_TAKEOVER = 40;
+static const qint64 LOCAL_MOTION_GAP = 100;
+static const qint64 EDGE_CROSS_RESEND = 200;
 
 CursorHandler::CursorHandler(QObject *parent)
     : QObject{parent}
@@ -26,7 +38,19 @@ void CursorHandler::start()
 {
     qDebug() << Q_FUNC_INFO;
 
-    _timerId = startTimer(UPDATE_INTERVAL);
+    if (_cursorListener.start()) {
+        connect(&_cursorListener, &CursorListener::rawMotion, this, &CursorHandler::onRawMotion, Qt::UniqueConnection);
+        connect(&_cursorListener, &CursorListener::absoluteMotion, this, &CursorHandler::onAbsoluteMotion, Qt::UniqueConnection);
+        connect(&_cursorListener, &CursorListener::cursorMoved, this, &CursorHandler::onCursorMoved, Qt::UniqueConnection);
+        connect(&_cursorListener, &CursorListener::barrierHit, this, &CursorHandler::onBarrierHit, Qt::UniqueConnection);
+        updateBarriers();
+    }
+
+    _lastActivityTime = SharedCursor::monotonicMsecs();
+    _wakeupWindowStart = _lastActivityTime;
+    _running = true;
+    _suspended = false;
+    updateSuspended();
     emit started();
 }
 
@@ -39,9 +63,33 @@ void CursorHandler::stop()
         _timerId = 0;
     }
 
+    _running = false;
+    _suspended = false;
+    _cursorListener.stop();
+    _barrierTransits.clear();
     emit finished();
 }
 
+int CursorHandler::captureRate() const
+{
+    return _captureRate;
+}
+
+quint64 CursorHandler::wakeupCount() const
+{
+    return _wakeupCount;
+}
+
+int CursorHandler::wakeupRate() const
+{
+    return _wakeupRate;
+}
+
+bool CursorHandler::isSuspended() const
+{
+    return _suspended;
+}
+
 void CursorHandler::setHoldCursorPosition(const QPoint &pos)
 {
     qDebug() << Q_FUNC_INFO << pos;
@@ -52,48 +100,99 @@ void CursorHandler::setCurrentUuid(const QUuid &uuid)
 {
     qDebug() << Q_FUNC_INFO << uuid;
 
-    _transitUuid = uuid;
     _ownUuid = uuid;
+    _ownHandle = DeviceTable::allocate(uuid);
     _controlledByUuid = uuid;
-    _connnetionStates[uuid] = SharedCursor::Connected;
+    _controlledByHandle = _ownHandle;
 
-    auto it = _devices.find(uuid);
-    if (it != _devices.end()) {
-        _currentDevice = it.value();
+    if (_ownHandle >= 0) {
+        if (_connectionStates.size() <= _ownHandle)
+            _connectionStates.resize(_ownHandle + 1);
+        _connectionStates[_ownHandle] = SharedCursor::Connected;
     }
-    else {
-        _currentDevice.clear();
+
+    setTransit(_ownUuid, _ownHandle);
+    updateBarriers();
+    updateSuspended();
+}
+
+void CursorHandler::setTopology(const SharedCursor::TopologySnapshot &topology)
+{
+    if (topology.isNull())
+        return;
+
+    qDebug() << Q_FUNC_INFO << topology->version;
+
+    // the snapshot is immutable, it is read here without any locking
+    _topology = topology;
+    _transitIndexes.resize(topology->devices.size());
+
+    for (int i=0; i<topology->devices.size(); ++i) {
+        _transitIndexes[i].build(*topology, i);
     }
+
+    setCurrentDevice(_transitHandle);
+    updateBarriers();
+    updateSuspended();
 }
 
-void CursorHandler::setDevices(const QMap<QUuid, QSharedPointer<SharedCursor::Device> > &devices)
+void CursorHandler::setTransit(const QUuid &uuid, int handle)
 {
-    qDebug() << Q_FUNC_INFO;
+    _transitUuid = uuid;
+    _transitHandle = handle;
+    setCurrentDevice(handle);
+}
+
+void CursorHandler::setCurrentDevice(int handle)
+{
+    _currentIndex = transitIndex(handle);
+    _hasLastCheckedCursorPosition = false;
 
-    _devices = devices;
-    _currentDevice = devices.value(_ownUuid);
+    if (handle == _ownHandle)
+        _motionScale = SharedCursor::SUBPIXEL_SCALE;
+}
+
+const TransitIndex *CursorHandler::transitIndex(int handle) const
+{
+    const int index = _topology.isNull() ? -1 : _topology->indexOfHandle(handle);
+    return index >= 0 ? &_transitIndexes.at(index) : nullptr;
+}
+
+SharedCursor::ConnectionState CursorHandler::connectionState(int handle) const
+{
+    return handle >= 0 && handle < _connectionStates.size() ? _connectionStates.at(handle) : SharedCursor::Unknown;
 }
 
 void CursorHandler::setConnectionState(const QUuid &uuid, SharedCursor::ConnectionState state)
 {
-    _connnetionStates[uuid] = state;
+    const int handle = DeviceTable::handle(uuid);
+    if (handle < 0)
+        return;
+
+    const bool changed = connectionState(handle) != state;
+    if (_connectionStates.size() <= handle)
+        _connectionStates.resize(handle + 1);
+    _connectionStates[handle] = state;
+
+    if (changed) {
+        updateBarriers();
+        updateSuspended();
+    }
 
     switch (_controlState) {
     case SharedCursor::SelfControl:
         break;
     case SharedCursor::Master:
-        if (uuid == _transitUuid && state != SharedCursor::Connected) {
+        if (handle == _transitHandle && state != SharedCursor::Connected) {
             updateControlState(SharedCursor::SelfControl);
-            _transitUuid = _ownUuid;
-            _currentDevice = _devices.value(_transitUuid);
+            setTransit(_ownUuid, _ownHandle);
             emit remoteControl(_ownUuid, _ownUuid);
         }
         break;
     case SharedCursor::Slave:
         if (uuid == _controlledByUuid && state != SharedCursor::Connected) {
             updateControlState(SharedCursor::SelfControl);
-            _transitUuid = _ownUuid;
-            _currentDevice = _devices.value(_transitUuid);
+            setTransit(_ownUuid, _ownHandle);
         }
         break;
     }
@@ -104,7 +203,14 @@ void CursorHandler::setConnectionState(const QUuid &uuid, SharedCursor::Connecti
 void CursorHandler::setRemoteCursorDelta(const QPoint &pos)
 {
     Q_UNUSED(pos);
-    _lastRemoteCursorTime = QDateTime::currentDateTime();
+    const qint64 now = SharedCursor::monotonicMsecs();
+    const qint64 last = _lastRemoteCursorTime.exchange(now);
+
+    // the slave checks the master's edges itself and only echoes its position
+    // when none were received, without the listener that needs full rate polling.
+    // only the first delta of a burst posts an event to this thread
+    if (last < 0 || now - last >= IDLE_TIMEOUT)
+        QMetaObject::invokeMethod(this, &CursorHandler::updateTimerInterval, Qt::QueuedConnection);
 }
 
 void CursorHandler::setRemoteCursorPos(const QPoint &pos)
@@ -116,6 +222,8 @@ void CursorHandler::setRemoteCursorPos(const QPoint &pos)
 void CursorHandler::setRemoteControlState(const QUuid &master, const QUuid &slave)
 {
     _controlledByUuid = master;
+    _controlledByHandle = DeviceTable::handle(master);
+    _remoteIndex.clear();
 
     if (master != slave) {
         if (_ownUuid == master) updateControlState(SharedCursor::Master);
@@ -125,20 +233,109 @@ void CursorHandler::setRemoteControlState(const QUuid &master, const QUuid &slav
     else {
         updateControlState(SharedCursor::SelfControl);
         setCursorPosition(_holdCursorPosition);
-        _transitUuid = _ownUuid;
-        _currentDevice = _devices.value(_ownUuid);
+        setTransit(_ownUuid, _ownHandle);
     }
 
     qDebug() << Q_FUNC_INFO << master << slave << _controlState;
 }
 
+void CursorHandler::setRemoteTransits(const QVector<SharedCursor::Transit> &transits)
+{
+    const int index = _topology.isNull() ? -1 : _topology->indexOfHandle(_ownHandle);
+    _remoteIndex.build(transits, index >= 0 ? _topology->screensOf(index) : QVector<SharedCursor::Screen>());
+    _edgeCrossTime = -1;
+    _hasLastCheckedCursorPosition = false;
+
+    qDebug() << Q_FUNC_INFO << transits.size();
+}
+
+void CursorHandler::setRemoteEdgeCrossed(const QPoint &pos)
+{
+    if (_controlState != SharedCursor::Master || !_currentIndex)
+        return;
+
+    const SharedCursor::Transit *transit = _currentIndex->transitAt(pos);
+    if (!transit || transit->handle == _transitHandle)
+        return;
+
+    cursorCrossedTransit(*transit, pos);
+}
+
 void CursorHandler::timerEvent(QTimerEvent *e)
 {
     if (e->timerId() != _timerId)
         return;
 
+    countWakeup();
+    handleCursor();
+    updateTimerInterval();
+}
+
+void CursorHandler::onCursorMoved()
+{
+    // motion events can still arrive while barriers are unavailable
+    if (_suspended)
+        return;
+
+    countWakeup();
+    handleCursor();
+}
+
+void CursorHandler::onRawMotion(const QPointF &delta)
+{
+    if (_controlState != SharedCursor::Master)
+        return;
+
+    // exact unaccelerated deltas, the pointer is grabbed and never warped
+    _rawMotionRemainder += delta;
+
+    const QPoint motion = SharedCursor::pointToSubpixel(_rawMotionRemainder);
+    if (motion.isNull())
+        return;
+
+    _rawMotionRemainder -= QPointF(motion) / SharedCursor::SUBPIXEL_SCALE;
+    sendCursorMessage(_transitHandle, SharedCursor::Message::CursorDelta, scaleDelta(motion));
+}
+
+void CursorHandler::onAbsoluteMotion()
+{
+    if (_controlState != SharedCursor::Master)
+        return;
+
+    // absolute pointing devices deliver no deltas, warp back as the polling path does
+    const QPoint &pos = QCursor::pos();
+    if (pos == _holdCursorPosition)
+        return;
+
+    setCursorPosition(_holdCursorPosition);
+    sendCursorMessage(_transitHandle, SharedCursor::Message::CursorDelta, scaleDelta((pos - _holdCursorPosition) * SharedCursor::SUBPIXEL_SCALE));
+}
+
+void CursorHandler::onBarrierHit(int index, const QPoint &pos)
+{
+    if (_controlState != SharedCursor::SelfControl)
+        return;
+
+    if (index < 0 || index >= _barrierTransits.size())
+        return;
+
+    const SharedCursor::Transit *transit = _barrierTransits.at(index);
+    if (transit->handle == _transitHandle)
+        return;
+
+    countWakeup();
+    cursorCrossedTransit(*transit, pos);
+}
+
+void CursorHandler::handleCursor()
+{
     const QPoint &pos = QCursor::pos();
 
+    if (pos != _lastCursorPosition ||
+        (_controlState == SharedCursor::SelfControl && isNearTransit(pos))) {
+        _lastActivityTime = SharedCursor::monotonicMsecs();
+    }
+
     switch (_controlState) {
     case SharedCursor::SelfControl:
         checkCursor(pos);
@@ -147,11 +344,19 @@ void CursorHandler::timerEvent(QTimerEvent *e)
         if (pos == _lastCursorPosition)
             break;
 
+        // deltas come from raw motion events
+        if (_cursorListener.isActive())
+            break;
+
         setCursorPosition(_holdCursorPosition);
-        sendCursorMessage(_transitUuid, SharedCursor::KEY_CURSOR_DELTA, pos - _holdCursorPosition);
+        sendCursorMessage(_transitHandle, SharedCursor::Message::CursorDelta, scaleDelta((pos - _holdCursorPosition) * SharedCursor::SUBPIXEL_SCALE));
         break;
     case SharedCursor::Slave:
-        sendCursorMessage(_controlledByUuid,SharedCursor::KEY_CURSOR_POS, pos);
+        // masters that sent no edges still decide from the echoed position
+        if (!_remoteIndex.isEmpty())
+            checkRemoteEdges(pos);
+        else if (pos != _lastCursorPosition)
+            sendCursorMessage(_controlledByHandle, SharedCursor::Message::CursorPos, pos);
         checkSelfControlInSlaveMode(pos);
         break;
     }
@@ -159,118 +364,211 @@ void CursorHandler::timerEvent(QTimerEvent *e)
     _lastCursorPosition = pos;
 }
 
-void CursorHandler::checkCursor(const QPoint &pos)
+void CursorHandler::countWakeup()
 {
-    if (_currentDevice.isNull())
-        return;
+    ++_wakeupCount;
+    ++_wakeupWindowCount;
+
+    const qint64 now = SharedCursor::monotonicMsecs();
+    if (now - _wakeupWindowStart >= 1000) {
+        _wakeupRate = static_cast<int>(_wakeupWindowCount * 1000 / (now - _wakeupWindowStart));
+        _wakeupWindowStart = now;
+        _wakeupWindowCount = 0;
+    }
+}
 
-    if (_currentDevice->transits.isEmpty())
+void CursorHandler::updateSuspended()
+{
+    if (!_running)
         return;
 
-    // point belongs to the line
-    QUuid newTransitUuid = _transitUuid;
-    auto transitIterator = _currentDevice->transits.begin();
-    for (; transitIterator<_currentDevice->transits.end(); ++transitIterator) {
-        const QLine &line = transitIterator->line;
-        if (line.x1() <= pos.x() && line.x2() >= pos.x() &&
-            line.y1() <= pos.y() && line.y2() >= pos.y()) {
-            if (newTransitUuid != transitIterator->uuid) {
-                newTransitUuid = transitIterator->uuid;
-            }
-            break;
-        }
+    // nothing to switch to, the cursor can not leave this device
+    const bool suspended = _controlState == SharedCursor::SelfControl && !hasConnectedTransit();
+
+    if (suspended && _timerId) {
+        killTimer(_timerId);
+        _timerId = 0;
+        _captureRate = 0;
+        _wakeupRate = 0;
+    }
+    else if (!suspended && !_timerId) {
+        _timerInterval = timerInterval();
+        _timerId = startTimer(_timerInterval, _timerInterval < PRECISE_TIMER_LIMIT ? Qt::PreciseTimer : Qt::CoarseTimer);
+        _captureRate = 1000 / _timerInterval;
+        _wakeupWindowStart = SharedCursor::monotonicMsecs();
+        _wakeupWindowCount = 0;
     }
 
-    // point just crossed the disabled screen
-    auto screens = _currentDevice->screens;
-    for (auto screenIt=screens.begin(); screenIt<screens.end(); ++screenIt) {
-        if (screenIt->enabled)
-            continue;
+    if (_suspended != suspended) {
+        _suspended = suspended;
+        updateBarriers();
+        qDebug() << Q_FUNC_INFO << suspended;
+    }
+}
 
-        if (!screenIt->rect.contains(pos))
-            continue;
+bool CursorHandler::hasConnectedTransit() const
+{
+    const TransitIndex *index = transitIndex(_ownHandle);
+    if (!index)
+        return false;
 
-        transitIterator = _currentDevice->transits.begin();
-        QLineF lineF(pos, _lastCheckedCursorPosition);
+    for (const SharedCursor::Transit &transit: index->transits()) {
+        if (transit.handle != _ownHandle && connectionState(transit.handle) == SharedCursor::Connected)
+            return true;
+    }
 
-        for (; transitIterator<_currentDevice->transits.end(); ++transitIterator) {
-            if (!lineF.intersects(transitIterator->line.toLineF()))
-                continue;
+    return false;
+}
 
-            if (newTransitUuid != transitIterator->uuid) {
-                newTransitUuid = transitIterator->uuid;
-            }
-            break;
-        }
+void CursorHandler::checkCursor(const QPoint &pos)
+{
+    if (!_currentIndex || _currentIndex->isEmpty())
+        return;
 
-        if (transitIterator != _currentDevice->transits.end())
-            break;
-    }
+    // point belongs to the line
+    QPoint transitPos = pos;
+    const SharedCursor::Transit *transit = _currentIndex->transitAt(pos);
+
+    // motion since the last check went through the line
+    if (!transit && _hasLastCheckedCursorPosition)
+        transit = _currentIndex->transitCrossed(_lastCheckedCursorPosition, pos, transitPos);
 
     _lastCheckedCursorPosition = pos;
+    _hasLastCheckedCursorPosition = true;
 
-    if (newTransitUuid == _transitUuid)
+    if (!transit || transit->handle == _transitHandle)
         return;
 
-    cursorCrossedTransit(*transitIterator, pos);
+    cursorCrossedTransit(*transit, transitPos);
 }
 
 void CursorHandler::checkSelfControlInSlaveMode(const QPoint &pos)
 {
-    if (_lastRemoteCursorTime.addMSecs(1000) < QDateTime::currentDateTime() &&
-        pos != _lastCursorPosition)
-    {
-        ++_selfCotrolInSlaveModeCounter;
+    const qint64 now = SharedCursor::monotonicMsecs();
+    const bool remoteQuiet = _lastRemoteCursorTime < 0 || now - _lastRemoteCursorTime > REMOTE_QUIET_TIME;
+
+    // measured in time rather than ticks, so the rule does not depend on the sampling rate
+    if (remoteQuiet && pos != _lastCursorPosition) {
+        if (_localMotionStart < 0 || now - _lastLocalMotionTime > LOCAL_MOTION_GAP)
+            _localMotionStart = now;
+        _lastLocalMotionTime = now;
+    }
+    else if (!remoteQuiet || (_localMotionStart >= 0 && now - _lastLocalMotionTime > LOCAL_MOTION_GAP)) {
+        resetLocalMotion();
     }
-    else _selfCotrolInSlaveModeCounter = 0;
 
-    if (_selfCotrolInSlaveModeCounter > 10)
+    if (_localMotionStart >= 0 && _lastLocalMotionTime - _localMotionStart >= LOCAL_MOTION_TAKEOVER)
     {
         emit remoteControl(_transitUuid, _transitUuid);
         updateControlState(SharedCursor::SelfControl);
-        _selfCotrolInSlaveModeCounter = 0;
-        _transitUuid = _ownUuid;
+        resetLocalMotion();
+        setTransit(_ownUuid, _ownHandle);
     }
 }
 
-void CursorHandler::cursorCrossedTransit(const SharedCursor::Transit &transit, const QPoint &pos)
+void CursorHandler::resetLocalMotion()
 {
-    QUuid newTransitUuid = transit.uuid;
+    _localMotionStart = -1;
+    _lastLocalMotionTime = -1;
+}
+
+void CursorHandler::checkRemoteEdges(const QPoint &pos)
+{
+    QPoint transitPos = pos;
+    const SharedCursor::Transit *transit = _remoteIndex.transitAt(pos);
+
+    if (!transit && _hasLastCheckedCursorPosition && pos != _lastCheckedCursorPosition)
+        transit = _remoteIndex.transitCrossed(_lastCheckedCursorPosition, pos, transitPos);
+
+    _lastCheckedCursorPosition = pos;
+    _hasLastCheckedCursorPosition = true;
+
+    if (!transit) {
+        _edgeCrossTime = -1;
+        return;
+    }
+
+    // one event per arrival at an edge, the master answers with a control switch,
+    // repeat it on the next hit if no switch followed
+    const qint64 now = SharedCursor::monotonicMsecs();
+    if (_edgeCrossTime >= 0 && now - _edgeCrossTime < EDGE_CROSS_RESEND)
+        return;
+
+    _edgeCrossTime = now;
+    sendCursorMessage(_controlledByHandle, SharedCursor::Message::CrossedEdge, transitPos);
+}
 
-    if (_connnetionStates.value(newTransitUuid) != SharedCursor::Connected )
+void CursorHandler::sendTransits(const QUuid &uuid)
+{
+    if (!_currentIndex)
         return;
 
-    if (!_devices.contains(newTransitUuid))
+    QJsonObject json;
+    json.insert(SharedCursor::KEY_TYPE, SharedCursor::KEY_EDGES);
+    json.insert(SharedCursor::KEY_TRANSITS, SharedCursor::transitListToJsonValue(_currentIndex->transits()));
+    emit jsonMessage(uuid, json);
+}
+
+void CursorHandler::cursorCrossedTransit(const SharedCursor::Transit &transit, const QPoint &pos)
+{
+    if (connectionState(transit.handle) != SharedCursor::Connected)
         return;
 
-    _transitUuid = newTransitUuid;
-    _currentTransitState = _connnetionStates.value(_transitUuid);
-    _currentDevice = _devices.value(_transitUuid);
+    if (!transitIndex(transit.handle))
+        return;
 
+    // the transit belongs to the index of the device being left
     const QPoint remotePos = calculateRemotePos(transit, pos);
+    const int scale = _currentIndex ? _currentIndex->motionScale(transit) : SharedCursor::SUBPIXEL_SCALE;
+
+    setTransit(transit.uuid, transit.handle);
+    _currentTransitState = connectionState(_transitHandle);
+
+    // deltas stay in local pixels, the scale follows the chain of devices passed through
+    if (_transitHandle != _ownHandle)
+        _motionScale = qMax(1, _motionScale * scale / SharedCursor::SUBPIXEL_SCALE);
     emit remoteControl(_ownUuid, _transitUuid);
-    sendCursorMessage(_transitUuid, SharedCursor::KEY_INIT_CURSOR_POS, remotePos);
+    sendCursorMessage(_transitHandle, SharedCursor::Message::InitCursorPos, remotePos);
 
-    if (_transitUuid == _ownUuid) {
+    if (_transitHandle == _ownHandle) {
         updateControlState(SharedCursor::SelfControl);
         setCursorPosition(remotePos);
     }
     else {
         updateControlState(SharedCursor::Master);
         setCursorPosition(_holdCursorPosition);
+        _rawMotionRemainder = QPointF();
+        sendTransits(_transitUuid);
     }
 
     qDebug() << Q_FUNC_INFO << _transitUuid << _controlState;
 }
 
-void CursorHandler::sendCursorMessage(const QUuid &uuid, const char *type, const QPoint &pos)
+QPoint CursorHandler::calculateRemotePos(const SharedCursor::Transit &transit, const QPoint &pos)
 {
-    if (pos == _lastCursorPosition)
-        return;
+    if (_currentIndex)
+        return _currentIndex->remotePos(transit, pos);
 
-    _jsonPosition[SharedCursor::KEY_TYPE] = type;
-    _jsonPosition[SharedCursor::KEY_VALUE] = SharedCursor::pointToJsonValue(pos);
-    emit message(uuid, _jsonPosition);
+    const QLine &line = transit.line;
+    QPoint remoteCursorPosition(transit.pos.x(), transit.pos.y() + (pos.y() - line.y1()));
+
+    if (line.y1() == line.y2()) {
+        remoteCursorPosition = {transit.pos.x() + (pos.x() - line.x1()), transit.pos.y()};
+    }
+
+    return remoteCursorPosition;
+}
+
+void CursorHandler::sendCursorMessage(int handle, SharedCursor::Message::Type type, const QPoint &pos)
+{
+    _cursorMessage.type = type;
+    _cursorMessage.point = pos;
+    emit message(handle, _cursorMessage);
+}
+
+QPoint CursorHandler::scaleDelta(const QPoint &delta) const
+{
+    return QPoint(delta.x() * _motionScale / SharedCursor::SUBPIXEL_SCALE, delta.y() * _motionScale / SharedCursor::SUBPIXEL_SCALE);
 }
 
 void CursorHandler::setCursorPosition(const QPoint &pos)
@@ -282,18 +580,85 @@ void CursorHandler::updateControlState(SharedCursor::ControlState state)
 {
     if (_controlState != state) {
         _controlState = state;
+        updateBarriers();
+        updateSuspended();
+        updateTimerInterval();
         emit controlStateChanged(state);
     }
 }
 
-QPoint CursorHandler::calculateRemotePos(const SharedCursor::Transit &transit, const QPoint &pos)
+void CursorHandler::updateTimerInterval()
 {
-    const QLine &line = transit.line;
-    QPoint remoteCursorPosition(transit.pos.x(), transit.pos.y() + (pos.y() - line.y1()));
+    if (!_timerId)
+        return;
 
-    if (line.y1() == line.y2()) {
-        remoteCursorPosition = {transit.pos.x() + (pos.x() - line.x1()), transit.pos.y()};
+    const int interval = timerInterval();
+    if (interval == _timerInterval)
+        return;
+
+    killTimer(_timerId);
+    _timerId = startTimer(interval, interval < PRECISE_TIMER_LIMIT ? Qt::PreciseTimer : Qt::CoarseTimer);
+    _timerInterval = interval;
+    _captureRate = 1000 / interval;
+}
+
+void CursorHandler::updateBarriers()
+{
+    if (!_cursorListener.isActive())
+        return;
+
+    QVector<CursorListener::Barrier> barriers;
+    QVector<const SharedCursor::Transit*> transits;
+    bool unguarded = false;
+
+    // the pointer only rests on edges leading to a connected device while it is on this device
+    const TransitIndex *index = transitIndex(_ownHandle);
+    if (_controlState == SharedCursor::SelfControl && index) {
+        const QVector<TransitIndex::Boundary> &boundaries = index->boundaries();
+
+        for (const TransitIndex::Boundary &boundary: boundaries) {
+            const int handle = boundary.transit->handle;
+            if (handle == _ownHandle || connectionState(handle) != SharedCursor::Connected)
+                continue;
+
+            if (!boundary.direction) {
+                unguarded = true;
+                continue;
+            }
+
+            barriers.append({boundary.line, boundary.direction});
+            transits.append(boundary.transit);
+        }
     }
 
-    return remoteCursorPosition;
+    if (!_cursorListener.setBarriers(barriers)) {
+        _barrierTransits.clear();
+        // without barriers every motion event is needed, unless there is nowhere to go
+        _cursorListener.setMotionEnabled(!_suspended);
+        return;
+    }
+
+    _barrierTransits = transits;
+
+    // barrier hits replace sampling every motion event while the cursor is local,
+    // an edge without a barrier still needs every motion event to be noticed
+    _cursorListener.setMotionEnabled(_controlState != SharedCursor::SelfControl || unguarded);
+}
+
+int CursorHandler::timerInterval() const
+{
+    // pointer events drive the handler, the timer only catches what they miss.
+    // motion injected on the slave arrives as raw events of the xtest device too
+    if (_cursorListener.isActive())
+        return LISTENER_UPDATE_INTERVAL;
+
+    if (SharedCursor::monotonicMsecs() - qMax<qint64>(_lastActivityTime, _lastRemoteCursorTime) < IDLE_TIMEOUT)
+        return FAST_UPDATE_INTERVAL;
+
+    return IDLE_UPDATE_INTERVAL;
+}
+
+bool CursorHandler::isNearTransit(const QPoint &pos) const
+{
+    return _currentIndex && _currentIndex->isNearTransit(pos, NEAR_TRANSIT_DISTANCE);
 }
@@ -3,7 +3,11 @@
 #include <QObject>
 #include <QJsonObject>
 #include <QSharedPointer>
-#include <QDateTime>
+#include <atomic>
+
+#include "cursorlistener.h"
+#include "transitindex.h"
+#include "message.h"
 #include "global.h"
 
 class CursorHandler : public QObject
@@ -13,54 +17,104 @@ public:
     explicit CursorHandler(QObject *parent = nullptr);
     ~CursorHandler();
 
+    int captureRate() const;
+    quint64 wakeupCount() const;
+    int wakeupRate() const;
+    bool isSuspended() const;
+
 public slots:
     void start();
     void stop();
 
     void setHoldCursorPosition(const QPoint &pos);
     void setCurrentUuid(const QUuid &uuid);
-    void setDevices(const QMap<QUuid, QSharedPointer<SharedCursor::Device>> &_devices);
+    void setTopology(const SharedCursor::TopologySnapshot &topology);
 
     void setConnectionState(const QUuid &uuid, SharedCursor::ConnectionState state);
+    // thread safe, the network thread calls it directly for every delta
     void setRemoteCursorDelta(const QPoint &pos);
     void setRemoteCursorPos(const QPoint &pos);
     void setRemoteControlState(const QUuid &master, const QUuid &slave);
+    void setRemoteTransits(const QVector<SharedCursor::Transit> &transits);
+    void setRemoteEdgeCrossed(const QPoint &pos);
 
 signals:
     void started();
     void finished();
-    void message(const QUuid &uuid, const QJsonObject &json);
+    void message(int handle, const SharedCursor::Message &message);
+    void jsonMessage(const QUuid &uuid, const QJsonObject &json);
     void remoteControl(const QUuid &master, const QUuid &slave);
     void controlStateChanged(SharedCursor::ControlState state);
 
 private:
     int _timerId = 0;
+    int _timerInterval = 0;
+    qint64 _lastActivityTime = 0;
+    std::atomic<int> _captureRate{0};
+    std::atomic<quint64> _wakeupCount{0};
+    std::atomic<int> _wakeupRate{0};
+    std::atomic<bool> _suspended{false};
+    bool _running = false;
+    qint64 _wakeupWindowStart = 0;
+    quint64 _wakeupWindowCount = 0;
+    CursorListener _cursorListener{this};
     SharedCursor::ControlState _controlState = SharedCursor::SelfControl;
     SharedCursor::ConnectionState _currentTransitState = SharedCursor::Unknown;
     QUuid _transitUuid;
     QUuid _ownUuid;
+    int _transitHandle = -1;
+    int _ownHandle = -1;
     QUuid _controlledByUuid;
-    QJsonObject _jsonDelta, _jsonPosition, _jsonRemoteControl;
+    int _controlledByHandle = -1;
+    SharedCursor::Message _cursorMessage;
     QPoint _lastCursorPosition = {0, 0};
     QPoint _holdCursorPosition = {0, 0};
     QPoint _lastCheckedCursorPosition = {0, 0};
-    bool _deviceContainsDisableScreen = false;
-    QSharedPointer<SharedCursor::Device> _currentDevice;
-    QMap<QUuid, QSharedPointer<SharedCursor::Device>> _devices;
-    QMap<QUuid, SharedCursor::ConnectionState> _connnetionStates;
-    QDateTime _lastRemoteCursorTime;
-    int _selfCotrolInSlaveModeCounter = 0;
+    bool _hasLastCheckedCursorPosition = false;
+    QPointF _rawMotionRemainder;
+    int _motionScale = SharedCursor::SUBPIXEL_SCALE;
+    const TransitIndex *_currentIndex = nullptr;
+    QVector<TransitIndex> _transitIndexes;
+    // edges of this device in the layout of the master controlling it
+    TransitIndex _remoteIndex;
+    qint64 _edgeCrossTime = -1;
+    QVector<const SharedCursor::Transit*> _barrierTransits;
+    SharedCursor::TopologySnapshot _topology;
+    QVector<SharedCursor::ConnectionState> _connectionStates;
+    std::atomic<qint64> _lastRemoteCursorTime{-1};
+    qint64 _localMotionStart = -1;
+    qint64 _lastLocalMotionTime = -1;
 
     void timerEvent(QTimerEvent *e) final;
+    void onCursorMoved();
+    void onRawMotion(const QPointF &delta);
+    void onAbsoluteMotion();
+    void onBarrierHit(int index, const QPoint &pos);
+    void handleCursor();
+    void countWakeup();
+    void updateSuspended();
+    bool hasConnectedTransit() const;
+    void updateBarriers();
+    void setTransit(const QUuid &uuid, int handle);
+    void setCurrentDevice(int handle);
+    const TransitIndex *transitIndex(int handle) const;
+    SharedCursor::ConnectionState connectionState(int handle) const;
     void checkCursor(const QPoint &pos);
     void checkSelfControlInSlaveMode(const QPoint &pos);
+    void resetLocalMotion();
+    void checkRemoteEdges(const QPoint &pos);
+    void sendTransits(const QUuid &uuid);
     void cursorCrossedTransit(const SharedCursor::Transit &transit, const QPoint &pos);
     void sendCursorDelta(const QUuid &uuid, const QPoint &pos);
     void sendCursorPosition(const QUuid &uuid, const QPoint &pos);
-    void sendCursorMessage(const QUuid &uuid, const char* type, const QPoint &pos);
+    void sendCursorMessage(int handle, SharedCursor::Message::Type type, const QPoint &pos);
     void setCursorPosition(const QPoint &pos);
+    QPoint scaleDelta(const QPoint &delta) const;
     void sendRemoteControlMessage(bool state, const QPoint &pos);
     void updateControlState(SharedCursor::ControlState state);
+    void updateTimerInterval();
+    int timerInterval() const;
+    bool isNearTransit(const QPoint &pos) const;
 
     QPoint calculateRemotePos(const SharedCursor::Transit &transit, const QPoint &pos);
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QObject>
+#include <QPointF>
+#include <QVector>
+#include <QLine>
+#include <QSet>
+
+struct _XDisplay;
+class QSocketNotifier;
+
+class CursorListener : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CursorListener(QObject *parent = nullptr);
+    ~CursorListener();
+
+    struct Barrier
+    {
+        QLine line;
+        int direction = 0;
+    };
+
+    bool start();
+    void stop();
+    bool isActive() const;
+
+    bool setBarriers(const QVector<CursorListener::Barrier> &barriers);
+    void setMotionEnabled(bool state);
+
+signals:
+    void cursorMoved();
+    void rawMotion(const QPointF &delta);
+    void absoluteMotion();
+    void barrierHit(int index, const QPoint &pos);
+
+private:
+#if defined(Q_OS_LINUX)
+    _XDisplay *_display = nullptr;
+    int _xiOpcode = 0;
+    bool _motionEnabled = true;
+    bool _barriersSupported = false;
+    QSocketNotifier *_notifier = nullptr;
+    QSet<int> _absoluteDevices;
+    QVector<unsigned long> _barriers;
+
+    void selectEvents();
+    void destroyBarriers();
+    void onEventsAvailable();
+    void updateAbsoluteDevices();
+#endif
+};
@@ -0,0 +1,247 @@
+#include <QtGlobal>
+#if defined(Q_OS_LINUX)
+
+#include <QSocketNotifier>
+#include <QDebug>
+#include "cursorlistener.h"
+
+//sudo apt install libxi-dev libxfixes-dev
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xfixes.h>
+
+CursorListener::CursorListener(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+CursorListener::~CursorListener()
+{
+    stop();
+}
+
+bool CursorListener::start()
+{
+    if (_display)
+        return true;
+
+    _display = XOpenDisplay(nullptr);
+    if (!_display) {
+        qDebug() << Q_FUNC_INFO << "Error: Unable to open display";
+        return false;
+    }
+
+    int event = 0, error = 0;
+    int major = 2, minor = 3;
+
+    if (!XQueryExtension(_display, "XInputExtension", &_xiOpcode, &event, &error) ||
+        XIQueryVersion(_display, &major, &minor) != Success) {
+        qDebug() << Q_FUNC_INFO << "Error: XInput2 is not available";
+        stop();
+        return false;
+    }
+
+    // barrier events need XInput 2.3 and XFixes 5
+    int fixesMajor = 5, fixesMinor = 0;
+    _barriersSupported = (major > 2 || minor >= 3) &&
+            XFixesQueryExtension(_display, &event, &error) &&
+            XFixesQueryVersion(_display, &fixesMajor, &fixesMinor) && fixesMajor >= 5;
+
+    selectEvents();
+    updateAbsoluteDevices();
+
+    _notifier = new QSocketNotifier(ConnectionNumber(_display), QSocketNotifier::Read, this);
+    connect(_notifier, &QSocketNotifier::activated, this, &CursorListener::onEventsAvailable);
+
+    qDebug() << Q_FUNC_INFO << "XInput" << major << minor << "barriers" << _barriersSupported;
+    return true;
+}
+
+void CursorListener::stop()
+{
+    if (_notifier) {
+        _notifier->setEnabled(false);
+        delete _notifier;
+        _notifier = nullptr;
+    }
+
+    if (_display) {
+        destroyBarriers();
+        XCloseDisplay(_display);
+        _display = nullptr;
+    }
+}
+
+bool CursorListener::isActive() const
+{
+    return _notifier != nullptr;
+}
+
+bool CursorListener::setBarriers(const QVector<CursorListener::Barrier> &barriers)
+{
+    if (!_display || !_barriersSupported)
+        return false;
+
+    destroyBarriers();
+
+    const Window root = DefaultRootWindow(_display);
+
+    for (const Barrier &barrier: barriers) {
+        const QLine &line = barrier.line;
+        PointerBarrier id = 0;
+
+        // the pointer stops on the line and may only move back into the screen
+        if (line.x1() == line.x2()) {
+            const int x = barrier.direction > 0 ? line.x1() + 1 : line.x1();
+            id = XFixesCreatePointerBarrier(_display, root, x, line.y1(), x, line.y2() + 1,
+                                            barrier.direction > 0 ? BarrierNegativeX : BarrierPositiveX, 0, nullptr);
+        }
+        else {
+            const int y = barrier.direction > 0 ? line.y1() + 1 : line.y1();
+            id = XFixesCreatePointerBarrier(_display, root, line.x1(), y, line.x2() + 1, y,
+                                            barrier.direction > 0 ? BarrierNegativeY : BarrierPositiveY, 0, nullptr);
+        }
+
+        _barriers.append(id);
+    }
+
+    XFlush(_display);
+    return true;
+}
+
+void CursorListener::setMotionEnabled(bool state)
+{
+    if (_motionEnabled == state)
+        return;
+
+    _motionEnabled = state;
+
+    if (_display) {
+        selectEvents();
+    }
+}
+
+void CursorListener::selectEvents()
+{
+    unsigned char masterMask[XIMaskLen(XI_LASTEVENT)] = {0};
+    unsigned char hierarchyMask[XIMaskLen(XI_LASTEVENT)] = {0};
+    XISetMask(hierarchyMask, XI_HierarchyChanged);
+
+    if (_motionEnabled)
+        XISetMask(masterMask, XI_RawMotion);
+
+    if (_barriersSupported)
+        XISetMask(masterMask, XI_BarrierHit);
+
+    XIEventMask eventMasks[2];
+    eventMasks[0].deviceid = XIAllMasterDevices;
+    eventMasks[0].mask_len = sizeof(masterMask);
+    eventMasks[0].mask = masterMask;
+    eventMasks[1].deviceid = XIAllDevices;
+    eventMasks[1].mask_len = sizeof(hierarchyMask);
+    eventMasks[1].mask = hierarchyMask;
+
+    XISelectEvents(_display, DefaultRootWindow(_display), eventMasks, 2);
+    XFlush(_display);
+}
+
+void CursorListener::destroyBarriers()
+{
+    for (unsigned long id: std::as_const(_barriers)) {
+        XFixesDestroyPointerBarrier(_display, id);
+    }
+
+    _barriers.clear();
+}
+
+void CursorListener::onEventsAvailable()
+{
+    bool moved = false;
+    bool absolute = false;
+    QPointF delta;
+
+    while (XPending(_display)) {
+        XEvent event;
+        XNextEvent(_display, &event);
+
+        XGenericEventCookie *cookie = &event.xcookie;
+        if (cookie->type != GenericEvent || cookie->extension != _xiOpcode)
+            continue;
+
+        if (!XGetEventData(_display, cookie))
+            continue;
+
+        if (cookie->evtype == XI_RawMotion) {
+            const XIRawEvent *raw = static_cast<const XIRawEvent*>(cookie->data);
+            moved = true;
+
+            // raw values of relative devices are unaccelerated deltas,
+            // tablets and virtual machine pointers report absolute positions here
+            if (_absoluteDevices.contains(raw->sourceid)) {
+                absolute = true;
+            }
+            else {
+                const double *value = raw->raw_values;
+                for (int axis=0; axis<2 && axis<raw->valuators.mask_len * 8; ++axis) {
+                    if (!XIMaskIsSet(raw->valuators.mask, axis))
+                        continue;
+
+                    if (axis == 0) delta.rx() += *value;
+                    else delta.ry() += *value;
+                    ++value;
+                }
+            }
+        }
+        else if (cookie->evtype == XI_BarrierHit) {
+            const XIBarrierEvent *barrierEvent = static_cast<const XIBarrierEvent*>(cookie->data);
+            const int index = _barriers.indexOf(barrierEvent->barrier);
+
+            if (index >= 0) {
+                emit barrierHit(index, QPoint(static_cast<int>(barrierEvent->root_x),
+                                              static_cast<int>(barrierEvent->root_y)));
+            }
+        }
+        else if (cookie->evtype == XI_HierarchyChanged) {
+            updateAbsoluteDevices();
+        }
+
+        XFreeEventData(_display, cookie);
+    }
+
+    if (!delta.isNull())
+        emit rawMotion(delta);
+
+    if (absolute)
+        emit absoluteMotion();
+
+    // one notification per batch, the handler samples the latest position
+    if (moved)
+        emit cursorMoved();
+}
+
+void CursorListener::updateAbsoluteDevices()
+{
+    _absoluteDevices.clear();
+
+    int count = 0;
+    XIDeviceInfo *devices = XIQueryDevice(_display, XIAllDevices, &count);
+
+    for (int i=0; i<count; ++i) {
+        const XIDeviceInfo &device = devices[i];
+        if (device.use != XISlavePointer)
+            continue;
+
+        for (int j=0; j<device.num_classes; ++j) {
+            if (device.classes[j]->type != XIValuatorClass)
+                continue;
+
+            const XIValuatorClassInfo *valuator = reinterpret_cast<const XIValuatorClassInfo*>(device.classes[j]);
+            if (valuator->number == 0 && valuator->mode == XIModeAbsolute)
+                _absoluteDevices.insert(device.deviceid);
+        }
+    }
+
+    XIFreeDeviceInfo(devices);
+}
+#endif
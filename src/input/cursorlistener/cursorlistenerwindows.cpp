@@ -0,0 +1,44 @@
+#include <QtGlobal>
+#if defined(Q_OS_WIN)
+
+#include <QDebug>
+#include "cursorlistener.h"
+
+CursorListener::CursorListener(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+CursorListener::~CursorListener()
+{
+
+}
+
+bool CursorListener::start()
+{
+    // no event source yet, CursorHandler keeps polling
+    return false;
+}
+
+void CursorListener::stop()
+{
+
+}
+
+bool CursorListener::isActive() const
+{
+    return false;
+}
+
+bool CursorListener::setBarriers(const QVector<CursorListener::Barrier> &barriers)
+{
+    Q_UNUSED(barriers);
+    return false;
+}
+
+void CursorListener::setMotionEnabled(bool state)
+{
+    Q_UNUSED(state);
+}
+#endif
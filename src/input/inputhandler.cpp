@@ -7,6 +7,7 @@
 #include <QDebug>
 
 #include "inputhandler.h"
+#include "devicetable.h"
 #include "global.h"
 
 InputHandler::InputHandler(QWidget *parent)
@@ -17,8 +18,6 @@ InputHandler::InputHandler(QWidget *parent)
     setAttribute(Qt::WA_TranslucentBackground);
     setCursor(Qt::BlankCursor);
     setMouseTracking(true);
-
-    _jsonKey[SharedCursor::KEY_TYPE] = SharedCursor::KEY_INPUT;
 }
 
 void InputHandler::setUuid(const QUuid &uuid)
@@ -33,15 +32,17 @@ void InputHandler::setCenterIn(const QPoint &pos)
 
 void InputHandler::setRemoteControlState(const QUuid &master, const QUuid &slave)
 {
-    _remoteUuid = slave;
+    _remoteHandle = DeviceTable::handle(slave);
     _isActive = master != slave && _ownUuid == master;
 
     if (_isActive) {
         show();
         setFocus();
         activateWindow();
+        grabMouse();
     }
     else {
+        releaseMouse();
         hide();
     }
 }
@@ -100,10 +101,10 @@ bool InputHandler::event(QEvent *event)
 
 void InputHandler::sendKeyEventMessage(int keycode, bool pressed)
 {
-    _jsonKey[SharedCursor::KEY_INPUT] = SharedCursor::KEY_KEYBOARD;
-    _jsonKey[SharedCursor::KEY_VALUE] = keycode;
-    _jsonKey[SharedCursor::KEY_PRESSED] = pressed;
-    emit message(_remoteUuid, _jsonKey);
+    _inputMessage.type = SharedCursor::Message::Keyboard;
+    _inputMessage.value = keycode;
+    _inputMessage.pressed = pressed;
+    emit message(_remoteHandle, _inputMessage);
 }
 
 void InputHandler::keyStateChanged(QKeyEvent *event, bool pressed)
@@ -113,22 +114,23 @@ void InputHandler::keyStateChanged(QKeyEvent *event, bool pressed)
 
 void InputHandler::mouseStateChanged(QMouseEvent *event, bool pressed)
 {
-    _jsonKey[SharedCursor::KEY_INPUT] = SharedCursor::KEY_MOUSE;
-    _jsonKey[SharedCursor::KEY_PRESSED] = pressed;
+    _inputMessage.type = SharedCursor::Message::Mouse;
+    _inputMessage.pressed = pressed;
 
     switch(event->button()) {
-    case Qt::LeftButton: _jsonKey[SharedCursor::KEY_VALUE] = 0; break;
-    case Qt::MiddleButton: _jsonKey[SharedCursor::KEY_VALUE] = 1; break;
-    case Qt::RightButton: _jsonKey[SharedCursor::KEY_VALUE] = 2; break;
+    case Qt::LeftButton: _inputMessage.value = 0; break;
+    case Qt::MiddleButton: _inputMessage.value = 1; break;
+    case Qt::RightButton: _inputMessage.value = 2; break;
     default: break;
     }
 
-    emit message(_remoteUuid, _jsonKey);
+    emit message(_remoteHandle, _inputMessage);
 }
 
 void InputHandler::wheelStateChanged(QWheelEvent *event)
 {
-    _jsonKey[SharedCursor::KEY_INPUT] = SharedCursor::KEY_WHEEL;
-    _jsonKey[SharedCursor::KEY_VALUE] = static_cast<int>(event->angleDelta().y());
-    emit message(_remoteUuid, _jsonKey);
+    _inputMessage.type = SharedCursor::Message::Wheel;
+    _inputMessage.value = static_cast<int>(event->angleDelta().y());
+    _inputMessage.horizontal = static_cast<int>(event->angleDelta().x());
+    emit message(_remoteHandle, _inputMessage);
 }
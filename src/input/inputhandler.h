@@ -1,10 +1,11 @@
 #pragma once
 
-#include <QJsonObject>
 #include <QWidget>
 #include <QEvent>
 #include <QUuid>
 
+#include "message.h"
+
 class InputHandler : public QWidget
 {
     Q_OBJECT
@@ -12,7 +13,7 @@ public:
     explicit InputHandler(QWidget *parent = nullptr);
 
 signals:
-    void message(const QUuid &uuid, const QJsonObject &json);
+    void message(int handle, const SharedCursor::Message &message);
 
 public slots:
     void setUuid(const QUuid &uuid);
@@ -21,8 +22,9 @@ public slots:
 
 private:
     bool _isActive = false;
-    QUuid _ownUuid, _remoteUuid;
-    QJsonObject _jsonKey;
+    QUuid _ownUuid;
+    int _remoteHandle = -1;
+    SharedCursor::Message _inputMessage;
     QVector<int> _pressedKeys;
 
     void paintEvent(QPaintEvent *e) final;
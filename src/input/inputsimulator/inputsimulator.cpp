@@ -0,0 +1,181 @@
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "inputsimulator.h"
+
+static const int INPUT_QUEUE_SIZE = 256;
+
+qint64 InputSimulator::averageDelay() const
+{
+    return _averageDelay;
+}
+
+qint64 InputSimulator::takeMaxDelay()
+{
+    // the peak since the previous call, so runs with and without load can be compared
+    return _maxDelay.exchange(0);
+}
+
+quint64 InputSimulator::mergedEvents() const
+{
+    return _mergedEvents;
+}
+
+quint64 InputSimulator::injectedEvents() const
+{
+    return _injectedEvents;
+}
+
+void InputSimulator::queueCursorPosition(const QPoint &pos)
+{
+    InputEvent event;
+    event.type = InputEvent::CursorPosition;
+    event.point = pos;
+    enqueue(event);
+}
+
+void InputSimulator::queueCursorDelta(const QPoint &delta)
+{
+    InputEvent event;
+    event.type = InputEvent::CursorDelta;
+    event.point = delta;
+    enqueue(event);
+}
+
+void InputSimulator::queueKeyboardEvent(int keycode, bool state)
+{
+    InputEvent event;
+    event.type = InputEvent::Keyboard;
+    event.value = keycode;
+    event.state = state;
+    enqueue(event);
+}
+
+void InputSimulator::queueMouseEvent(int button, bool state)
+{
+    InputEvent event;
+    event.type = InputEvent::Mouse;
+    event.value = button;
+    event.state = state;
+    enqueue(event);
+}
+
+void InputSimulator::queueWheelEvent(int delta, int horizontalDelta)
+{
+    InputEvent event;
+    event.type = InputEvent::Wheel;
+    event.point = QPoint(horizontalDelta, delta);
+    enqueue(event);
+}
+
+void InputSimulator::startQueue()
+{
+    connect(&_queueNotifier, &WakeupNotifier::activated, this, &InputSimulator::processQueue, Qt::UniqueConnection);
+    _queueNotifier.start();
+}
+
+void InputSimulator::stopQueue()
+{
+    _queueNotifier.stop();
+}
+
+void InputSimulator::enqueue(InputEvent event)
+{
+    event.time = SharedCursor::monotonicNsecs();
+
+    QMutexLocker locker(&_queueMutex);
+
+    // a full queue sums up motion, nothing is ever dropped. a delta behind a key or
+    // button takes one more slot that the following deltas are merged into
+    if (_queue.size() >= INPUT_QUEUE_SIZE && event.type == InputEvent::CursorDelta && _queue.last().type == InputEvent::CursorDelta) {
+        _queue.last().point += event.point;
+        ++_mergedEvents;
+        return;
+    }
+
+    _queue.append(event);
+
+    // the injection thread is woken without posting an event, before start it gets one
+    if (_queue.size() == 1 && !_queueNotifier.wakeUp())
+        QMetaObject::invokeMethod(this, &InputSimulator::processQueue, Qt::QueuedConnection);
+}
+
+void InputSimulator::processQueue()
+{
+    {
+        QMutexLocker locker(&_queueMutex);
+        _processing.swap(_queue);
+    }
+
+    for (const InputEvent &event: std::as_const(_processing)) {
+        const qint64 delay = (SharedCursor::monotonicNsecs() - event.time) / 1000;
+        _averageDelay = _averageDelay + (delay - _averageDelay) / 16;
+        qint64 maxDelay = _maxDelay.load(std::memory_order_relaxed);
+        while (delay > maxDelay && !_maxDelay.compare_exchange_weak(maxDelay, delay, std::memory_order_relaxed)) {}
+
+        switch (event.type) {
+        case InputEvent::CursorPosition:
+            emit cursorPositionReceived(event.point);
+            setCursorPosition(event.point);
+            break;
+        case InputEvent::CursorDelta:
+            emit cursorDeltaReceived(event.point);
+            break;
+        // keys and buttons must not overtake motion still held in the playout buffer
+        case InputEvent::Keyboard:
+            emit motionFlushRequested();
+            setKeyboardEvent(event.value, event.state);
+            break;
+        case InputEvent::Mouse:
+            emit motionFlushRequested();
+            setMouseEvent(event.value, event.state);
+            break;
+        case InputEvent::Wheel:
+            emit motionFlushRequested();
+            setWheelEvent(event.point.y(), event.point.x());
+            break;
+        }
+    }
+
+    _injectedEvents += _processing.size();
+    _processing.clear();
+}
+
+void InputSimulator::clearKeymap()
+{
+    _keymap.fill(0);
+    _keymapEntries.reset();
+}
+
+void InputSimulator::setKeymapEntry(int keycode, unsigned short code)
+{
+    const int index = keymapIndex(keycode);
+    if (index < 0)
+        return;
+
+    _keymap[index] = code;
+    _keymapEntries.set(index);
+}
+
+unsigned short InputSimulator::nativeKeycode(int keycode) const
+{
+    const int index = keymapIndex(keycode);
+
+    // keys without an entry are passed through as native codes,
+    // an entry whose key is not on the keyboard stays 0 and the key is dropped
+    if (index < 0 || !_keymapEntries.test(index))
+        return static_cast<unsigned short>(keycode);
+
+    return _keymap[index];
+}
+
+int InputSimulator::keymapIndex(int keycode)
+{
+    if (keycode >= 0 && keycode < KEYMAP_LATIN1_SIZE)
+        return keycode;
+
+    if (keycode >= Qt::Key_Escape && keycode < Qt::Key_Escape + KEYMAP_SIZE - KEYMAP_LATIN1_SIZE)
+        return KEYMAP_LATIN1_SIZE + keycode - Qt::Key_Escape;
+
+    return -1;
+}
@@ -2,11 +2,19 @@
 
 #include <QObject>
 #include <QVector>
-#include <QMap>
+#include <QMutex>
+#include <QHash>
+#include <QRect>
+#include <atomic>
+#include <bitset>
+#include <array>
 
+#include "wakeupnotifier.h"
+#include "monotonicclock.h"
 #include "global.h"
 
 struct _XDisplay;
+class QSocketNotifier;
 
 class InputSimulator : public QObject
 {
@@ -15,26 +23,109 @@ public:
     explicit InputSimulator(QObject *parent = nullptr);
     ~InputSimulator();
 
+    qint64 averageDelay() const;
+    qint64 takeMaxDelay();
+    quint64 mergedEvents() const;
+    quint64 injectedEvents() const;
+
 public slots:
+    void start();
+    void stop();
+
+    // thread safe, the network thread calls these directly
+    void queueCursorPosition(const QPoint &pos);
+    void queueCursorDelta(const QPoint &delta);
+    void queueKeyboardEvent(int keycode, bool state);
+    void queueMouseEvent(int button, bool state);
+    void queueWheelEvent(int delta, int horizontalDelta);
+
     void setControlState(SharedCursor::ControlState state);
     void setCursorPosition(const QPoint &pos);
-    void setCursorDelta(const QPoint &pos);
+    void setCursorDelta(const QPoint &delta);
     void setKeyboardEvent(int keycode, bool state);
     void setMouseEvent(int button, bool state);
-    void setWheelEvent(int delta);
+    void setWheelEvent(int delta, int horizontalDelta);
+
+signals:
+    void cursorPositionReceived(const QPoint &pos);
+    void cursorDeltaReceived(const QPoint &delta);
+    void motionFlushRequested();
 
 private:
-    QMap<int, unsigned long> _keymap;
+    struct InputEvent
+    {
+        enum Type {
+            CursorPosition = 0,
+            CursorDelta,
+            Keyboard,
+            Mouse,
+            Wheel
+        };
+
+        Type type = CursorDelta;
+        QPoint point;
+        int value = 0;
+        bool state = false;
+        qint64 time = 0;
+    };
+
+    QMutex _queueMutex;
+    WakeupNotifier _queueNotifier{this};
+    QVector<InputEvent> _queue;
+    QVector<InputEvent> _processing;
+    std::atomic<qint64> _averageDelay{0};
+    std::atomic<qint64> _maxDelay{0};
+    std::atomic<quint64> _mergedEvents{0};
+    std::atomic<quint64> _injectedEvents{0};
+
+    // latin1 keys first, then the Qt::Key_Escape based function keys
+    static const int KEYMAP_LATIN1_SIZE = 0x80;
+    static const int KEYMAP_SIZE = KEYMAP_LATIN1_SIZE + 0x100;
+    std::array<unsigned short, KEYMAP_SIZE> _keymap{};
+    std::bitset<KEYMAP_SIZE> _keymapEntries;
     SharedCursor::ControlState _controlState = SharedCursor::SelfControl;
+    QPoint _cursorDeltaRemainder;
+    QPoint _wheelRemainder;
 
     bool _releaseProcess = false;
     QVector<int> _pressedKeys;
     QVector<int> _pressedMouse;
 
+    void startQueue();
+    void stopQueue();
+    void enqueue(InputEvent event);
+    void processQueue();
     void releasePressedKeys();
     void createKeymap();
+    void clearKeymap();
+    void setKeymapEntry(int keycode, unsigned short code);
+    unsigned short nativeKeycode(int keycode) const;
+    static int keymapIndex(int keycode);
 
 #if defined(Q_OS_LINUX)
+    // a monitor in native pixels with the device pixel ratio qt applies to it
+    struct Crtc
+    {
+        QRect rect;
+        qreal ratio = 1;
+    };
+
     _XDisplay *_display = nullptr;
+    bool _motionFlushPending = false;
+    QPoint _pendingMotion;
+    QPoint _cursorPos;
+    qint64 _lastMotionTime = -1;
+    QSocketNotifier *_notifier = nullptr;
+    int _randrEventBase = -1;
+    QVector<Crtc> _crtcs;
+    QHash<QString, qreal> _screenRatios;
+    qreal _primaryRatio = 1;
+
+    void flushCursorMotion();
+    void readCursorPos();
+    void updateCrtcs();
+    const Crtc *crtcAt(const QPoint &pos) const;
+    QPoint toNativePos(const QPoint &pos) const;
+    void onDisplayEvents();
 #endif
 };
@@ -1,26 +1,200 @@
 #include <QtGlobal>
 #if defined(Q_OS_LINUX)
 
+#include <QGuiApplication>
+#include <QSocketNotifier>
 #include <QCursor>
+#include <QScreen>
 #include <QDebug>
 #include "inputsimulator.h"
+#include "utils.h"
 
 //sudo apt install libxtst-dev
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <X11/extensions/XTest.h>
+#include <X11/extensions/Xrandr.h>
+
+static const int CURSOR_RESYNC_INTERVAL = 100;
+
+struct KeyPair
+{
+    int key;
+    unsigned long keysym;
+};
+
+static constexpr KeyPair KEYSYMS[] = {
+    { Qt::Key_Escape, XK_Escape },
+    { Qt::Key_Tab, XK_Tab },
+    { Qt::Key_Backspace, XK_BackSpace },
+    { Qt::Key_Return, XK_Return },
+    { Qt::Key_Enter, XK_Return },
+    { Qt::Key_Insert, XK_Insert },
+    { Qt::Key_Delete, XK_Delete },
+    { Qt::Key_Pause, XK_Pause },
+    { Qt::Key_Print, XK_Print },
+    { Qt::Key_Home, XK_Home },
+    { Qt::Key_End, XK_End },
+    { Qt::Key_Left, XK_Left },
+    { Qt::Key_Up, XK_Up },
+    { Qt::Key_Right, XK_Right },
+    { Qt::Key_Down, XK_Down },
+    { Qt::Key_PageUp, XK_Page_Up },
+    { Qt::Key_PageDown, XK_Page_Down },
+    { Qt::Key_Shift, XK_Shift_L },
+    { Qt::Key_Control, XK_Control_L },
+    { Qt::Key_Meta, XK_Meta_L },
+    { Qt::Key_Alt, XK_Alt_L },
+    { Qt::Key_CapsLock, XK_Caps_Lock },
+    { Qt::Key_NumLock, XK_Num_Lock },
+    { Qt::Key_ScrollLock, XK_Scroll_Lock },
+    { Qt::Key_F1, XK_F1 },
+    { Qt::Key_F2, XK_F2 },
+    { Qt::Key_F3, XK_F3 },
+    { Qt::Key_F4, XK_F4 },
+    { Qt::Key_F5, XK_F5 },
+    { Qt::Key_F6, XK_F6 },
+    { Qt::Key_F7, XK_F7 },
+    { Qt::Key_F8, XK_F8 },
+    { Qt::Key_F9, XK_F9 },
+    { Qt::Key_F10, XK_F10 },
+    { Qt::Key_F11, XK_F11 },
+    { Qt::Key_F12, XK_F12 },
+    { Qt::Key_F13, XK_F13 },
+    { Qt::Key_F14, XK_F14 },
+    { Qt::Key_Super_L, XK_Super_L },
+    { Qt::Key_Super_R, XK_Super_R },
+    { Qt::Key_Menu, XK_Menu },
+    { Qt::Key_Hyper_L, XK_Hyper_L },
+    { Qt::Key_Hyper_R, XK_Hyper_R },
+    { Qt::Key_Help, XK_Help },
+    { Qt::Key_Space, XK_space },
+    { Qt::Key_Exclam, XK_exclam },
+    { Qt::Key_QuoteDbl, XK_quotedbl },
+    { Qt::Key_NumberSign, XK_numbersign },
+    { Qt::Key_Dollar, XK_dollar },
+    { Qt::Key_Percent, XK_percent },
+    { Qt::Key_Ampersand, XK_ampersand },
+    { Qt::Key_Apostrophe, XK_apostrophe },
+    { Qt::Key_ParenLeft, XK_parenleft },
+    { Qt::Key_ParenRight, XK_parenright },
+    { Qt::Key_Asterisk, XK_asterisk },
+    { Qt::Key_Plus, XK_plus },
+    { Qt::Key_Comma, XK_comma },
+    { Qt::Key_Minus, XK_minus },
+    { Qt::Key_Period, XK_period },
+    { Qt::Key_Slash, XK_slash },
+    { Qt::Key_0, XK_0 },
+    { Qt::Key_1, XK_1 },
+    { Qt::Key_2, XK_2 },
+    { Qt::Key_3, XK_3 },
+    { Qt::Key_4, XK_4 },
+    { Qt::Key_5, XK_5 },
+    { Qt::Key_6, XK_6 },
+    { Qt::Key_7, XK_7 },
+    { Qt::Key_8, XK_8 },
+    { Qt::Key_9, XK_9 },
+    { Qt::Key_Colon, XK_colon },
+    { Qt::Key_Semicolon, XK_semicolon },
+    { Qt::Key_Less, XK_comma },
+    { Qt::Key_Equal, XK_equal },
+    { Qt::Key_Greater, XK_greater },
+    { Qt::Key_Question, XK_question },
+    { Qt::Key_At, XK_at },
+    { Qt::Key_A, XK_A },
+    { Qt::Key_B, XK_B },
+    { Qt::Key_C, XK_C },
+    { Qt::Key_D, XK_D },
+    { Qt::Key_E, XK_E },
+    { Qt::Key_F, XK_F },
+    { Qt::Key_G, XK_G },
+    { Qt::Key_H, XK_H },
+    { Qt::Key_I, XK_I },
+    { Qt::Key_J, XK_J },
+    { Qt::Key_K, XK_K },
+    { Qt::Key_L, XK_L },
+    { Qt::Key_M, XK_M },
+    { Qt::Key_N, XK_N },
+    { Qt::Key_O, XK_O },
+    { Qt::Key_P, XK_P },
+    { Qt::Key_Q, XK_Q },
+    { Qt::Key_R, XK_R },
+    { Qt::Key_S, XK_S },
+    { Qt::Key_T, XK_T },
+    { Qt::Key_U, XK_U },
+    { Qt::Key_V, XK_V },
+    { Qt::Key_W, XK_W },
+    { Qt::Key_X, XK_X },
+    { Qt::Key_Y, XK_Y },
+    { Qt::Key_Z, XK_Z },
+    { Qt::Key_BracketLeft, XK_bracketleft },
+    { Qt::Key_Backslash, XK_backslash },
+    { Qt::Key_BracketRight, XK_bracketright },
+    { Qt::Key_AsciiCircum, XK_asciicircum },
+    { Qt::Key_Underscore, XK_underscore },
+    { Qt::Key_QuoteLeft, XK_quoteleft },
+    { Qt::Key_BraceLeft, XK_braceleft },
+    { Qt::Key_Bar, XK_bar },
+    { Qt::Key_BraceRight, XK_braceright },
+    { Qt::Key_AsciiTilde, XK_asciitilde }
+};
 
 InputSimulator::InputSimulator(QObject *parent)
     : QObject{parent}
 {
+    // created on the gui thread, screens can only be read here.
+    // qt names its screens after the randr outputs
+    for (QScreen *screen: QGuiApplication::screens()) {
+        _screenRatios.insert(screen->name(), screen->devicePixelRatio());
+    }
+
+    if (QGuiApplication::primaryScreen())
+        _primaryRatio = QGuiApplication::primaryScreen()->devicePixelRatio();
+}
+
+InputSimulator::~InputSimulator()
+{
+    stop();
+}
+
+void InputSimulator::start()
+{
+    qDebug() << Q_FUNC_INFO;
+
+    // the connection belongs to the injection thread
     _display = XOpenDisplay(nullptr);
     createKeymap();
+    startQueue();
+
+    // keyboard mapping changes arrive as MappingNotify on every connection
+    if (_display) {
+        int errorBase = 0;
+        if (XRRQueryExtension(_display, &_randrEventBase, &errorBase))
+            XRRSelectInput(_display, DefaultRootWindow(_display), RRScreenChangeNotifyMask);
+        else
+            _randrEventBase = -1;
+
+        updateCrtcs();
+
+        _notifier = new QSocketNotifier(ConnectionNumber(_display), QSocketNotifier::Read, this);
+        connect(_notifier, &QSocketNotifier::activated, this, &InputSimulator::onDisplayEvents);
+    }
 }
 
-InputSimulator::~InputSimulator()
+void InputSimulator::stop()
 {
-    if (_display)
+    stopQueue();
+
+    if (_notifier) {
+        _notifier->setEnabled(false);
+        delete _notifier;
+        _notifier = nullptr;
+    }
+
+    if (_display) {
         XCloseDisplay(_display);
+        _display = nullptr;
+    }
 }
 
 void InputSimulator::setControlState(SharedCursor::ControlState state)
@@ -30,17 +204,49 @@ void InputSimulator::setControlState(SharedCursor::ControlState state)
             releasePressedKeys();
         }
         _controlState = state;
+        _cursorDeltaRemainder = QPoint();
+        _pendingMotion = QPoint();
+        _wheelRemainder = QPoint();
     }
 }
 
 void InputSimulator::setCursorPosition(const QPoint &pos)
 {
-    QCursor::setPos(pos);
+    _cursorDeltaRemainder = QPoint();
+    _pendingMotion = QPoint();
+
+    if (!_display) {
+        QCursor::setPos(pos);
+        return;
+    }
+
+    // positions come in qt device independent pixels, xtest expects native ones
+    _cursorPos = toNativePos(pos);
+    XTestFakeMotionEvent(_display, -1, _cursorPos.x(), _cursorPos.y(), CurrentTime);
+    XFlush(_display);
+    _lastMotionTime = SharedCursor::monotonicMsecs();
 }
 
-void InputSimulator::setCursorDelta(const QPoint &pos)
+void InputSimulator::setCursorDelta(const QPoint &delta)
 {
-    QCursor::setPos(QCursor::pos() + pos);
+    if (!_display) {
+        // delta is in subpixel units, slow motion adds up until it reaches a whole pixel
+        _cursorDeltaRemainder += delta;
+
+        const QPoint motion = SharedCursor::takeWholePixels(_cursorDeltaRemainder);
+        if (!motion.isNull())
+            QCursor::setPos(QCursor::pos() + motion);
+        return;
+    }
+
+    // kept in subpixel units until the monitor under the cursor gives the pixel ratio
+    _pendingMotion += delta;
+
+    // deltas already queued behind this one are merged into a single request
+    if (!_motionFlushPending) {
+        _motionFlushPending = true;
+        QMetaObject::invokeMethod(this, &InputSimulator::flushCursorMotion, Qt::QueuedConnection);
+    }
 }
 
 void InputSimulator::setKeyboardEvent(int keycode, bool state)
@@ -53,15 +259,11 @@ void InputSimulator::setKeyboardEvent(int keycode, bool state)
     if (!_display)
         return;
 
-    unsigned char code = 0;
+    flushCursorMotion();
 
-    auto it = _keymap.find(keycode);
-    if (it != _keymap.end()) {
-        code = XKeysymToKeycode(_display, it.value());
-    }
-    else {
-        code = static_cast<unsigned char>(keycode);
-    }
+    const unsigned char code = static_cast<unsigned char>(nativeKeycode(keycode));
+    if (!code)
+        return;
 
     XTestFakeKeyEvent(_display, code, state, 0);
     XFlush(_display);
@@ -77,6 +279,9 @@ void InputSimulator::setMouseEvent(int button, bool state)
     if (!_display)
         return;
 
+    // buttons act at the position the motion before them led to
+    flushCursorMotion();
+
     if (button == 0) { //left
         XTestFakeButtonEvent(_display, Button1, state, 0);
     }
@@ -90,16 +295,151 @@ void InputSimulator::setMouseEvent(int button, bool state)
     XFlush(_display);
 }
 
-void InputSimulator::setWheelEvent(int delta)
+void InputSimulator::setWheelEvent(int delta, int horizontalDelta)
+{
+    if (!_display)
+        return;
+
+    flushCursorMotion();
+
+    // high resolution wheels send fractions of a notch, x11 only knows whole clicks
+    _wheelRemainder += QPoint(horizontalDelta, delta);
+
+    const int notchesX = _wheelRemainder.x() / SharedCursor::WHEEL_STEP;
+    const int notchesY = _wheelRemainder.y() / SharedCursor::WHEEL_STEP;
+    _wheelRemainder -= QPoint(notchesX, notchesY) * SharedCursor::WHEEL_STEP;
+
+    if (!notchesX && !notchesY)
+        return;
+
+    const unsigned int buttonX = notchesX < 0 ? 7 : 6;
+    const unsigned int buttonY = notchesY < 0 ? Button5 : Button4;
+
+    for (int i=0; i<qAbs(notchesX); ++i) {
+        XTestFakeButtonEvent(_display, buttonX, true, CurrentTime);
+        XTestFakeButtonEvent(_display, buttonX, false, CurrentTime);
+    }
+
+    for (int i=0; i<qAbs(notchesY); ++i) {
+        XTestFakeButtonEvent(_display, buttonY, true, CurrentTime);
+        XTestFakeButtonEvent(_display, buttonY, false, CurrentTime);
+    }
+
+    XFlush(_display);
+}
+
+void InputSimulator::flushCursorMotion()
 {
-    Display *display = XOpenDisplay(nullptr);
-    quint32 btnNum = delta < 0 ? Button5 : Button4;
+    _motionFlushPending = false;
 
-    XTestFakeButtonEvent(display, btnNum, true, 0);
-    XTestFakeButtonEvent(display, btnNum, false, 0);
+    if (_pendingMotion.isNull())
+        return;
+
+    // xtest relative motion is accelerated by the server, so the position is tracked here
+    // and only read back after a pause, the local pointer may have moved meanwhile
+    if (_lastMotionTime < 0 || SharedCursor::monotonicMsecs() - _lastMotionTime > CURSOR_RESYNC_INTERVAL)
+        readCursorPos();
+
+    const Crtc *crtc = crtcAt(_cursorPos);
+    if (!crtc) {
+        readCursorPos();
+        crtc = crtcAt(_cursorPos);
+    }
+
+    const qreal ratio = crtc ? crtc->ratio : _primaryRatio;
+    _cursorDeltaRemainder += QPoint(qRound(_pendingMotion.x() * ratio), qRound(_pendingMotion.y() * ratio));
+    _pendingMotion = QPoint();
+
+    const QPoint motion = SharedCursor::takeWholePixels(_cursorDeltaRemainder);
+    if (motion.isNull())
+        return;
+
+    // gaps between monitors of different size are not part of the screen, motion into
+    // them would only pile up distance the cursor has to travel back
+    const QPoint target = _cursorPos + motion;
+    if (crtc && !crtcAt(target)) {
+        _cursorPos = QPoint(qBound(crtc->rect.left(), target.x(), crtc->rect.right()),
+                            qBound(crtc->rect.top(), target.y(), crtc->rect.bottom()));
+    }
+    else {
+        _cursorPos = target;
+    }
+
+    XTestFakeMotionEvent(_display, -1, _cursorPos.x(), _cursorPos.y(), CurrentTime);
+    XFlush(_display);
+    _lastMotionTime = SharedCursor::monotonicMsecs();
+}
+
+void InputSimulator::readCursorPos()
+{
+    Window root, child;
+    int rootX = 0, rootY = 0, winX = 0, winY = 0;
+    unsigned int mask = 0;
+
+    if (XQueryPointer(_display, DefaultRootWindow(_display), &root, &child, &rootX, &rootY, &winX, &winY, &mask))
+        _cursorPos = QPoint(rootX, rootY);
+}
+
+void InputSimulator::updateCrtcs()
+{
+    _crtcs.clear();
+
+    XRRScreenResources *resources = _randrEventBase >= 0 ? XRRGetScreenResourcesCurrent(_display, DefaultRootWindow(_display)) : nullptr;
+    if (resources) {
+        for (int i=0; i<resources->noutput; ++i) {
+            XRROutputInfo *output = XRRGetOutputInfo(_display, resources, resources->outputs[i]);
+            if (!output)
+                continue;
+
+            XRRCrtcInfo *info = output->connection == RR_Connected && output->crtc ? XRRGetCrtcInfo(_display, resources, output->crtc) : nullptr;
+            if (info) {
+                if (info->width && info->height) {
+                    Crtc crtc;
+                    crtc.rect = QRect(info->x, info->y, info->width, info->height);
+                    crtc.ratio = _screenRatios.value(QString::fromLocal8Bit(output->name, output->nameLen), _primaryRatio);
+                    _crtcs.append(crtc);
+                }
+                XRRFreeCrtcInfo(info);
+            }
+
+            XRRFreeOutputInfo(output);
+        }
+
+        XRRFreeScreenResources(resources);
+    }
+
+    // without randr the whole root window is one monitor
+    if (_crtcs.isEmpty()) {
+        const int screen = DefaultScreen(_display);
+        Crtc crtc;
+        crtc.rect = QRect(0, 0, DisplayWidth(_display, screen), DisplayHeight(_display, screen));
+        crtc.ratio = _primaryRatio;
+        _crtcs.append(crtc);
+    }
 
-    XFlush(display);
-    XCloseDisplay(display);
+    qDebug() << Q_FUNC_INFO << _crtcs.size();
+}
+
+const InputSimulator::Crtc *InputSimulator::crtcAt(const QPoint &pos) const
+{
+    for (const Crtc &crtc: _crtcs) {
+        if (crtc.rect.contains(pos))
+            return &crtc;
+    }
+
+    return nullptr;
+}
+
+QPoint InputSimulator::toNativePos(const QPoint &pos) const
+{
+    // qt keeps the native origin of each monitor and scales the size only
+    for (const Crtc &crtc: _crtcs) {
+        const QRect logical(crtc.rect.topLeft(), crtc.rect.size() / crtc.ratio);
+        if (logical.contains(pos))
+            return crtc.rect.topLeft() + (pos - crtc.rect.topLeft()) * crtc.ratio;
+    }
+
+    return pos;
 }
 
 void InputSimulator::releasePressedKeys()
@@ -121,122 +461,48 @@ void InputSimulator::releasePressedKeys()
     _releaseProcess = false;
 }
 
+void InputSimulator::onDisplayEvents()
+{
+    bool mappingChanged = false;
+    bool screensChanged = false;
+
+    while (XPending(_display)) {
+        XEvent event;
+        XNextEvent(_display, &event);
+
+        if (_randrEventBase >= 0 && event.type == _randrEventBase + RRScreenChangeNotify) {
+            XRRUpdateConfiguration(&event);
+            screensChanged = true;
+            continue;
+        }
+
+        if (event.type != MappingNotify)
+            continue;
+
+        XRefreshKeyboardMapping(&event.xmapping);
+        if (event.xmapping.request == MappingKeyboard)
+            mappingChanged = true;
+    }
+
+    if (mappingChanged) {
+        qDebug() << Q_FUNC_INFO << "keyboard mapping changed";
+        createKeymap();
+    }
+
+    if (screensChanged)
+        updateCrtcs();
+}
+
 void InputSimulator::createKeymap()
 {
-    _keymap = {
-        { Qt::Key_Escape, XK_Escape },
-        { Qt::Key_Tab, XK_Tab },
-        { Qt::Key_Backspace, XK_BackSpace },
-        { Qt::Key_Return, XK_Return },
-        { Qt::Key_Enter, XK_Return },
-        { Qt::Key_Insert, XK_Insert },
-        { Qt::Key_Delete, XK_Delete },
-        { Qt::Key_Pause, XK_Pause },
-        { Qt::Key_Print, XK_Print },
-        { Qt::Key_Home, XK_Home },
-        { Qt::Key_End, XK_End },
-        { Qt::Key_Left, XK_Left },
-        { Qt::Key_Up, XK_Up },
-        { Qt::Key_Right, XK_Right },
-        { Qt::Key_Down, XK_Down },
-        { Qt::Key_PageUp, XK_Page_Up },
-        { Qt::Key_PageDown, XK_Page_Down },
-        { Qt::Key_Shift, XK_Shift_L },
-        { Qt::Key_Control, XK_Control_L },
-        { Qt::Key_Meta, XK_Meta_L },
-        { Qt::Key_Alt, XK_Alt_L },
-        { Qt::Key_CapsLock, XK_Caps_Lock },
-        { Qt::Key_NumLock, XK_Num_Lock },
-        { Qt::Key_ScrollLock, XK_Scroll_Lock },
-        { Qt::Key_F1, XK_F1 },
-        { Qt::Key_F2, XK_F2 },
-        { Qt::Key_F3, XK_F3 },
-        { Qt::Key_F4, XK_F4 },
-        { Qt::Key_F5, XK_F5 },
-        { Qt::Key_F6, XK_F6 },
-        { Qt::Key_F7, XK_F7 },
-        { Qt::Key_F8, XK_F8 },
-        { Qt::Key_F9, XK_F9 },
-        { Qt::Key_F10, XK_F10 },
-        { Qt::Key_F11, XK_F11 },
-        { Qt::Key_F12, XK_F12 },
-        { Qt::Key_F13, XK_F13 },
-        { Qt::Key_F14, XK_F14 },
-        { Qt::Key_Super_L, XK_Super_L },
-        { Qt::Key_Super_R, XK_Super_R },
-        { Qt::Key_Menu, XK_Menu },
-        { Qt::Key_Hyper_L, XK_Hyper_L },
-        { Qt::Key_Hyper_R, XK_Hyper_R },
-        { Qt::Key_Help, XK_Help },
-        { Qt::Key_Space, XK_space },
-        { Qt::Key_Exclam, XK_exclam },
-        { Qt::Key_QuoteDbl, XK_quotedbl },
-        { Qt::Key_NumberSign, XK_numbersign },
-        { Qt::Key_Dollar, XK_dollar },
-        { Qt::Key_Percent, XK_percent },
-        { Qt::Key_Ampersand, XK_ampersand },
-        { Qt::Key_Apostrophe, XK_apostrophe },
-        { Qt::Key_ParenLeft, XK_parenleft },
-        { Qt::Key_ParenRight, XK_parenright },
-        { Qt::Key_Asterisk, XK_asterisk },
-        { Qt::Key_Plus, XK_plus },
-        { Qt::Key_Comma, XK_comma },
-        { Qt::Key_Minus, XK_minus },
-        { Qt::Key_Period, XK_period },
-        { Qt::Key_Slash, XK_slash },
-        { Qt::Key_0, XK_0 },
-        { Qt::Key_1, XK_1 },
-        { Qt::Key_2, XK_2 },
-        { Qt::Key_3, XK_3 },
-        { Qt::Key_4, XK_4 },
-        { Qt::Key_5, XK_5 },
-        { Qt::Key_6, XK_6 },
-        { Qt::Key_7, XK_7 },
-        { Qt::Key_8, XK_8 },
-        { Qt::Key_9, XK_9 },
-        { Qt::Key_Colon, XK_colon },
-        { Qt::Key_Semicolon, XK_semicolon },
-        { Qt::Key_Less, XK_comma },
-        { Qt::Key_Equal, XK_equal },
-        { Qt::Key_Greater, XK_greater },
-        { Qt::Key_Question, XK_question },
-        { Qt::Key_At, XK_at },
-        { Qt::Key_A, XK_A },
-        { Qt::Key_B, XK_B },
-        { Qt::Key_C, XK_C },
-        { Qt::Key_D, XK_D },
-        { Qt::Key_E, XK_E },
-        { Qt::Key_F, XK_F },
-        { Qt::Key_G, XK_G },
-        { Qt::Key_H, XK_H },
-        { Qt::Key_I, XK_I },
-        { Qt::Key_J, XK_J },
-        { Qt::Key_K, XK_K },
-        { Qt::Key_L, XK_L },
-        { Qt::Key_M, XK_M },
-        { Qt::Key_N, XK_N },
-        { Qt::Key_O, XK_O },
-        { Qt::Key_P, XK_P },
-        { Qt::Key_Q, XK_Q },
-        { Qt::Key_R, XK_R },
-        { Qt::Key_S, XK_S },
-        { Qt::Key_T, XK_T },
-        { Qt::Key_U, XK_U },
-        { Qt::Key_V, XK_V },
-        { Qt::Key_W, XK_W },
-        { Qt::Key_X, XK_X },
-        { Qt::Key_Y, XK_Y },
-        { Qt::Key_Z, XK_Z },
-        { Qt::Key_BracketLeft, XK_bracketleft },
-        { Qt::Key_Backslash, XK_backslash },
-        { Qt::Key_BracketRight, XK_bracketright },
-        { Qt::Key_AsciiCircum, XK_asciicircum },
-        { Qt::Key_Underscore, XK_underscore },
-        { Qt::Key_QuoteLeft, XK_quoteleft },
-        { Qt::Key_BraceLeft, XK_braceleft },
-        { Qt::Key_Bar, XK_bar },
-        { Qt::Key_BraceRight, XK_braceright },
-        { Qt::Key_AsciiTilde, XK_asciitilde }
-    };
+    clearKeymap();
+
+    if (!_display)
+        return;
+
+    for (const KeyPair &pair: KEYSYMS) {
+        setKeymapEntry(pair.key, XKeysymToKeycode(_display, pair.keysym));
+    }
 }
+
 #endif
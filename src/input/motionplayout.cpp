@@ -0,0 +1,179 @@
+#include <QTimerEvent>
+#include <QDebug>
+
+#include "monotonicclock.h"
+#include "motionplayout.h"
+
+static const int PLAYOUT_INTERVAL = 4;
+static const int MIN_PLAYOUT_DELAY = 4;
+static const int MAX_PLAYOUT_DELAY = 40;
+static const int EXTRAPOLATION_LIMIT = 16;
+static const int MAX_ARRIVAL_INTERVAL = 100;
+
+MotionPlayout::MotionPlayout(QObject *parent)
+    : QObject{parent}
+{
+    _playoutDelay = MIN_PLAYOUT_DELAY;
+}
+
+MotionPlayout::~MotionPlayout()
+{
+    stopPlayout();
+}
+
+bool MotionPlayout::isEnabled() const
+{
+    return _enabled;
+}
+
+int MotionPlayout::bufferDepth() const
+{
+    return _bufferDepth;
+}
+
+int MotionPlayout::playoutDelay() const
+{
+    return _playoutDelay;
+}
+
+quint64 MotionPlayout::latePackets() const
+{
+    return _latePackets;
+}
+
+void MotionPlayout::setEnabled(bool state)
+{
+    qDebug() << Q_FUNC_INFO << state;
+
+    _enabled = state;
+    reset();
+}
+
+void MotionPlayout::addDelta(const QPoint &delta)
+{
+    if (!_enabled) {
+        emit cursorDelta(delta);
+        return;
+    }
+
+    const qint64 now = SharedCursor::monotonicMsecs();
+
+    // a pause in motion starts a new stream, it says nothing about jitter
+    if (_lastArrivalTime >= 0 && now - _lastArrivalTime < MAX_ARRIVAL_INTERVAL) {
+        const qint64 interval = now - _lastArrivalTime;
+
+        // packet came after its slot was already played out
+        if (_samples.isEmpty() && interval > _arrivalInterval + _playoutDelay)
+            ++_latePackets;
+
+        // interarrival jitter estimate as in rtp
+        _jitter += (qAbs(interval - _arrivalInterval) - _jitter) / 16.;
+        _arrivalInterval += (interval - _arrivalInterval) / 8.;
+
+        if (interval > 0)
+            _velocity += (QPointF(delta) / interval - _velocity) / 4.;
+
+        _playoutDelay = qBound(MIN_PLAYOUT_DELAY, qRound(2 * _jitter), MAX_PLAYOUT_DELAY);
+    }
+    else {
+        _velocity = QPointF();
+    }
+
+    _lastArrivalTime = now;
+
+    // motion played ahead by extrapolation is taken back from the real one
+    _samples.enqueue({now, delta - _extrapolated});
+    _extrapolated = QPoint();
+    _bufferDepth = _samples.size();
+
+    startPlayout();
+}
+
+void MotionPlayout::flush()
+{
+    // everything buffered is played out at once, extrapolation not backed by a sample is taken back
+    QPoint motion;
+    while (!_samples.isEmpty()) {
+        motion += _samples.dequeue().delta;
+    }
+
+    if (motion.isNull())
+        motion = -_extrapolated;
+
+    _extrapolated = QPoint();
+    _lastPlayoutTime = -1;
+    _bufferDepth = 0;
+    stopPlayout();
+
+    if (!motion.isNull())
+        emit cursorDelta(motion);
+}
+
+void MotionPlayout::reset()
+{
+    stopPlayout();
+
+    _samples.clear();
+    _lastArrivalTime = -1;
+    _lastPlayoutTime = -1;
+    _velocity = QPointF();
+    _extrapolated = QPoint();
+    _bufferDepth = 0;
+}
+
+void MotionPlayout::timerEvent(QTimerEvent *e)
+{
+    if (e->timerId() != _timerId)
+        return;
+
+    const qint64 now = SharedCursor::monotonicMsecs();
+    const int delay = _playoutDelay;
+    QPoint motion;
+
+    while (!_samples.isEmpty() && _samples.head().time + delay <= now) {
+        motion += _samples.dequeue().delta;
+    }
+
+    _bufferDepth = _samples.size();
+
+    if (!motion.isNull()) {
+        _lastPlayoutTime = now;
+        emit cursorDelta(motion);
+        return;
+    }
+
+    if (!_samples.isEmpty())
+        return;
+
+    // buffer ran dry, keep the cursor going for a short while
+    if (_lastPlayoutTime >= 0 && now - _lastPlayoutTime < EXTRAPOLATION_LIMIT) {
+        const QPoint step = (_velocity * PLAYOUT_INTERVAL).toPoint();
+        if (!step.isNull()) {
+            _extrapolated += step;
+            emit cursorDelta(step);
+        }
+        return;
+    }
+
+    // motion stopped, extrapolation overshot it
+    if (!_extrapolated.isNull()) {
+        emit cursorDelta(-_extrapolated);
+        _extrapolated = QPoint();
+    }
+
+    stopPlayout();
+}
+
+void MotionPlayout::startPlayout()
+{
+    if (!_timerId)
+        _timerId = startTimer(PLAYOUT_INTERVAL, Qt::PreciseTimer);
+}
+
+void MotionPlayout::stopPlayout()
+{
+    if (_timerId) {
+        killTimer(_timerId);
+        _timerId = 0;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QPointF>
+#include <QQueue>
+#include <atomic>
+
+class MotionPlayout : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MotionPlayout(QObject *parent = nullptr);
+    ~MotionPlayout();
+
+    bool isEnabled() const;
+    int bufferDepth() const;
+    int playoutDelay() const;
+    quint64 latePackets() const;
+
+public slots:
+    void setEnabled(bool state);
+    void addDelta(const QPoint &delta);
+    void flush();
+    void reset();
+
+signals:
+    void cursorDelta(const QPoint &delta);
+
+private:
+    struct Sample
+    {
+        qint64 time = 0;
+        QPoint delta;
+    };
+
+    bool _enabled = false;
+    int _timerId = 0;
+    QQueue<Sample> _samples;
+    qint64 _lastArrivalTime = -1;
+    qint64 _lastPlayoutTime = -1;
+    qreal _arrivalInterval = 0;
+    qreal _jitter = 0;
+    QPointF _velocity;
+    QPoint _extrapolated;
+    std::atomic<int> _bufferDepth{0};
+    std::atomic<int> _playoutDelay{0};
+    std::atomic<quint64> _latePackets{0};
+
+    void timerEvent(QTimerEvent *e) final;
+    void startPlayout();
+    void stopPlayout();
+};
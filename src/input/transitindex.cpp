@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <climits>
+
+#include "transitindex.h"
+
+void TransitIndex::build(const SharedCursor::Topology &topology, int index)
+{
+    const QVector<SharedCursor::Screen> &screens = topology.screensOf(index);
+    build(topology.transitsOf(index), screens);
+
+    for (int i=0; i<_transits.size(); ++i) {
+        const SharedCursor::Transit &transit = _transits.at(i);
+
+        // motion keeps its physical speed, scale is the density ratio of both screens
+        const SharedCursor::Screen *source = screenAt(screens, transit.line.center());
+        const int target = topology.indexOfHandle(transit.handle);
+
+        if (source && target >= 0) {
+            const QVector<SharedCursor::Screen> &targetScreens = topology.screensOf(target);
+            if (const SharedCursor::Screen *screen = screenAt(targetScreens, transit.pos)) {
+                _mappings[i].motionScale = qMax(1, qRound(qreal(SharedCursor::SUBPIXEL_SCALE) * screen->dpi / source->dpi));
+                _mappings[i].targetRect = screen->rect;
+            }
+        }
+    }
+}
+
+void TransitIndex::build(const QVector<SharedCursor::Transit> &transits, const QVector<SharedCursor::Screen> &screens)
+{
+    clear();
+
+    _transits = transits;
+    _mappings.resize(_transits.size());
+
+    for (int i=0; i<_transits.size(); ++i) {
+        const QLine &line = _transits.at(i).line;
+        const QPoint &center = line.center();
+
+        // edges are stored as (coord, start..end), vertical by x and horizontal by y
+        if (line.x1() == line.x2()) {
+            _verticalEdges.append({line.x1(), qMin(line.y1(), line.y2()), qMax(line.y1(), line.y2()),
+                                   edgeDirection(screens, center, true), i});
+        }
+        else {
+            _horizontalEdges.append({line.y1(), qMin(line.x1(), line.x2()), qMax(line.x1(), line.x2()),
+                                     edgeDirection(screens, center, false), i});
+        }
+    }
+
+    std::sort(_verticalEdges.begin(), _verticalEdges.end(), edgeLess);
+    std::sort(_horizontalEdges.begin(), _horizontalEdges.end(), edgeLess);
+}
+
+void TransitIndex::clear()
+{
+    _transits.clear();
+    _mappings.clear();
+    _verticalEdges.clear();
+    _horizontalEdges.clear();
+}
+
+bool TransitIndex::isEmpty() const
+{
+    return _transits.isEmpty();
+}
+
+const QVector<SharedCursor::Transit> &TransitIndex::transits() const
+{
+    return _transits;
+}
+
+bool TransitIndex::isNearTransit(const QPoint &pos, int distance) const
+{
+    auto isNear = [distance](const QVector<Edge> &edges, int coord, int value) {
+        auto it = std::lower_bound(edges.begin(), edges.end(), Edge{coord - distance, INT_MIN, 0, 0, 0}, edgeLess);
+        for (; it != edges.end() && it->coord <= coord + distance; ++it) {
+            if (it->start - distance < value && it->end + distance > value)
+                return true;
+        }
+        return false;
+    };
+
+    return isNear(_verticalEdges, pos.x(), pos.y()) || isNear(_horizontalEdges, pos.y(), pos.x());
+}
+
+const SharedCursor::Transit *TransitIndex::transitAt(const QPoint &pos) const
+{
+    const Edge *edge = findEdge(_verticalEdges, pos.x(), pos.y());
+    if (!edge)
+        edge = findEdge(_horizontalEdges, pos.y(), pos.x());
+
+    return edge ? &_transits.at(edge->transit) : nullptr;
+}
+
+const SharedCursor::Transit *TransitIndex::transitCrossed(const QPoint &from, const QPoint &to, QPoint &crossPos) const
+{
+    const Edge *edge = findCrossedEdge(_verticalEdges, from, to, crossPos);
+
+    if (!edge) {
+        edge = findCrossedEdge(_horizontalEdges, QPoint(from.y(), from.x()), QPoint(to.y(), to.x()), crossPos);
+        crossPos = QPoint(crossPos.y(), crossPos.x());
+    }
+
+    return edge ? &_transits.at(edge->transit) : nullptr;
+}
+
+QVector<TransitIndex::Boundary> TransitIndex::boundaries() const
+{
+    QVector<Boundary> result;
+
+    // edges with an unknown side keep direction 0, a barrier there can not be told
+    // apart from motion back into the screen
+    for (const Edge &edge: _verticalEdges) {
+        result.append({QLine(edge.coord, edge.start, edge.coord, edge.end), edge.direction, &_transits.at(edge.transit)});
+    }
+
+    for (const Edge &edge: _horizontalEdges) {
+        result.append({QLine(edge.start, edge.coord, edge.end, edge.coord), edge.direction, &_transits.at(edge.transit)});
+    }
+
+    return result;
+}
+
+int TransitIndex::motionScale(const SharedCursor::Transit &transit) const
+{
+    const Mapping *mapping = findMapping(transit);
+    return mapping ? mapping->motionScale : SharedCursor::SUBPIXEL_SCALE;
+}
+
+QPoint TransitIndex::remotePos(const SharedCursor::Transit &transit, const QPoint &pos) const
+{
+    const Mapping *mapping = findMapping(transit);
+    const QLine &line = transit.line;
+
+    // the entry point follows the layout one to one, only motion after it is scaled
+    QPoint result(transit.pos.x(), transit.pos.y() + (pos.y() - line.y1()));
+
+    if (line.y1() == line.y2()) {
+        result = {transit.pos.x() + (pos.x() - line.x1()), transit.pos.y()};
+    }
+
+    if (mapping && mapping->targetRect.isValid()) {
+        const QRect &rect = mapping->targetRect;
+        result = {qBound(rect.left(), result.x(), rect.right()), qBound(rect.top(), result.y(), rect.bottom())};
+    }
+
+    return result;
+}
+
+bool TransitIndex::edgeLess(const Edge &e1, const Edge &e2)
+{
+    return e1.coord < e2.coord || (e1.coord == e2.coord && e1.start < e2.start);
+}
+
+const SharedCursor::Screen *TransitIndex::screenAt(const QVector<SharedCursor::Screen> &screens, const QPoint &pos)
+{
+    for (const SharedCursor::Screen &screen: screens) {
+        if (screen.rect.contains(pos))
+            return &screen;
+    }
+
+    return nullptr;
+}
+
+int TransitIndex::edgeDirection(const QVector<SharedCursor::Screen> &screens, const QPoint &pos, bool vertical)
+{
+    const SharedCursor::Screen *screen = screenAt(screens, pos);
+    if (!screen)
+        return 0;
+
+    // the edge leads out of the screen on the side it is closest to
+    const QRect &rect = screen->rect;
+
+    if (vertical)
+        return pos.x() - rect.left() < rect.right() - pos.x() ? -1 : 1;
+
+    return pos.y() - rect.top() < rect.bottom() - pos.y() ? -1 : 1;
+}
+
+const TransitIndex::Mapping *TransitIndex::findMapping(const SharedCursor::Transit &transit) const
+{
+    // only looked up on a switch, the list holds a few transits
+    for (int i=0; i<_transits.size(); ++i) {
+        if (&_transits.at(i) == &transit)
+            return &_mappings.at(i);
+    }
+
+    return nullptr;
+}
+
+const TransitIndex::Edge *TransitIndex::findEdge(const QVector<Edge> &edges, int coord, int value) const
+{
+    // last edge on this coordinate starting at or before the value
+    auto it = std::upper_bound(edges.begin(), edges.end(), Edge{coord, value, 0, 0, 0}, edgeLess);
+
+    while (it != edges.begin()) {
+        --it;
+        if (it->coord != coord)
+            break;
+
+        if (it->end >= value)
+            return &(*it);
+    }
+
+    return nullptr;
+}
+
+const TransitIndex::Edge *TransitIndex::findCrossedEdge(const QVector<Edge> &edges, const QPoint &from, const QPoint &to, QPoint &crossPos) const
+{
+    if (from.x() == to.x())
+        return nullptr;
+
+    const int minCoord = qMin(from.x(), to.x());
+    const int maxCoord = qMax(from.x(), to.x());
+    const Edge *result = nullptr;
+
+    auto it = std::lower_bound(edges.begin(), edges.end(), Edge{minCoord, INT_MIN, 0, 0, 0}, edgeLess);
+
+    for (; it != edges.end() && it->coord <= maxCoord; ++it) {
+        // only motion leaving the screen through the edge counts
+        if (it->direction > 0 && !(from.x() < it->coord && to.x() >= it->coord))
+            continue;
+
+        if (it->direction < 0 && !(from.x() > it->coord && to.x() <= it->coord))
+            continue;
+
+        if (it->direction == 0)
+            continue;
+
+        const qreal value = from.y() + qreal(to.y() - from.y()) * (it->coord - from.x()) / (to.x() - from.x());
+        if (value < it->start || value > it->end)
+            continue;
+
+        // the edge closest to the start of the motion is crossed first
+        if (result && qAbs(it->coord - from.x()) >= qAbs(result->coord - from.x()))
+            continue;
+
+        result = &(*it);
+        crossPos = QPoint(it->coord, qRound(value));
+    }
+
+    return result;
+}
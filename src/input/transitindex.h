@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QVector>
+#include <QRect>
+
+#include "global.h"
+
+class TransitIndex
+{
+public:
+    struct Boundary
+    {
+        QLine line;
+        int direction = 0;
+        const SharedCursor::Transit *transit = nullptr;
+    };
+
+    void build(const SharedCursor::Topology &topology, int index);
+    void build(const QVector<SharedCursor::Transit> &transits, const QVector<SharedCursor::Screen> &screens);
+    void clear();
+
+    bool isEmpty() const;
+    const QVector<SharedCursor::Transit> &transits() const;
+    bool isNearTransit(const QPoint &pos, int distance) const;
+
+    const SharedCursor::Transit *transitAt(const QPoint &pos) const;
+    const SharedCursor::Transit *transitCrossed(const QPoint &from, const QPoint &to, QPoint &crossPos) const;
+    QVector<TransitIndex::Boundary> boundaries() const;
+
+    int motionScale(const SharedCursor::Transit &transit) const;
+    QPoint remotePos(const SharedCursor::Transit &transit, const QPoint &pos) const;
+
+private:
+    struct Edge
+    {
+        int coord = 0;
+        int start = 0;
+        int end = 0;
+        int direction = 0;
+        int transit = 0;
+    };
+
+    struct Mapping
+    {
+        int motionScale = SharedCursor::SUBPIXEL_SCALE;
+        QRect targetRect;
+    };
+
+    QVector<SharedCursor::Transit> _transits;
+    QVector<Mapping> _mappings;
+    QVector<Edge> _verticalEdges;
+    QVector<Edge> _horizontalEdges;
+
+    static bool edgeLess(const Edge &e1, const Edge &e2);
+    static const SharedCursor::Screen *screenAt(const QVector<SharedCursor::Screen> &screens, const QPoint &pos);
+    static int edgeDirection(const QVector<SharedCursor::Screen> &screens, const QPoint &pos, bool vertical);
+    const Mapping *findMapping(const SharedCursor::Transit &transit) const;
+    const Edge *findEdge(const QVector<Edge> &edges, int coord, int value) const;
+    const Edge *findCrossedEdge(const QVector<Edge> &edges, const QPoint &from, const QPoint &to, QPoint &crossPos) const;
+};
@@ -3,9 +3,12 @@
 #include "clipboardhandler.h"
 #include "settingswidget.h"
 #include "settingsfacade.h"
+#include "threadsettings.h"
 #include "inputsimulator.h"
+#include "motionplayout.h"
 #include "cursorhandler.h"
 #include "inputhandler.h"
+#include "framepool.h"
 #include "traymenu.h"
 #include "global.h"
 
@@ -14,6 +17,7 @@
 #include <QThreadPool>
 #include <QLocale>
 #include <QThread>
+#include <QTimer>
 #include <QUuid>
 
 #include <QDebug>
@@ -26,6 +30,9 @@ int main(int argc, char *argv[])
     qRegisterMetaType<SharedCursor::Device>("SharedCursor::Device");
     qRegisterMetaType<SharedCursor::ConnectionState>("SharedCursor::ConnectionState");
     qRegisterMetaType<QSharedPointer<SharedCursor::Device>>("QSharedPointer<SharedCursor::Device>");
+    qRegisterMetaType<SharedCursor::TopologySnapshot>("SharedCursor::TopologySnapshot");
+    qRegisterMetaType<SharedCursor::Message>("SharedCursor::Message");
+    qRegisterMetaType<QVector<SharedCursor::Transit>>("QVector<SharedCursor::Transit>");
     qRegisterMetaType<QMap<QUuid,QVector<SharedCursor::Transit>> >("QMap<QUuid,QVector<SharedCursor::Transit> >");
 
     QTranslator translator;
@@ -40,6 +47,16 @@ int main(int argc, char *argv[])
 
     Settings.loadFacadeProperties();
 
+    // priority, realtime policy and cpu affinity are applied from inside each thread
+    const QJsonObject &threadsConfig = Settings.value(SharedCursor::KEY_THREADS, QJsonObject()).toObject();
+    auto setupThread = [&threadsConfig](QThread &thread, const char *name) {
+        ThreadSettings settings;
+        settings.load(threadsConfig.value(name).toObject());
+        QObject::connect(&thread, &QThread::started, [settings, name]() {
+            qDebug() << "thread" << name << settings.apply();
+        });
+    };
+
     ClipboardHandler clipboardHandler;
     clipboardHandler.setCurrentUuid(Settings.uuid());
 
@@ -50,22 +67,41 @@ int main(int argc, char *argv[])
 
     InputSimulator inputSimulator;
 
+    MotionPlayout motionPlayout;
+    motionPlayout.setEnabled(Settings.value(SharedCursor::KEY_MOTION_PLAYOUT, false).toBool());
+
+    QThread inputSimulatorThread;
+    setupThread(inputSimulatorThread, SharedCursor::KEY_INJECTION);
+    QObject::connect(&inputSimulatorThread, &QThread::started, &inputSimulator, &InputSimulator::start);
+    QObject::connect(&inputSimulatorThread, &QThread::finished, &inputSimulator, &InputSimulator::stop);
+    QObject::connect(&inputSimulator, &InputSimulator::cursorPositionReceived, &motionPlayout, &MotionPlayout::reset);
+    QObject::connect(&inputSimulator, &InputSimulator::cursorDeltaReceived, &motionPlayout, &MotionPlayout::addDelta);
+    QObject::connect(&inputSimulator, &InputSimulator::motionFlushRequested, &motionPlayout, &MotionPlayout::flush);
+    QObject::connect(&motionPlayout, &MotionPlayout::cursorDelta, &inputSimulator, &InputSimulator::setCursorDelta);
+    inputSimulator.moveToThread(&inputSimulatorThread);
+    motionPlayout.moveToThread(&inputSimulatorThread);
+
     CursorHandler cursorHandler;
     cursorHandler.setHoldCursorPosition(Settings.screenRect().center());
 
     QThread cursorCheckerThread;
+    setupThread(cursorCheckerThread, SharedCursor::KEY_CAPTURE);
     QObject::connect(&cursorCheckerThread, &QThread::started, &cursorHandler, &CursorHandler::start);
     QObject::connect(&cursorCheckerThread, &QThread::finished, &cursorHandler, &CursorHandler::stop);
     QObject::connect(&cursorHandler, &CursorHandler::remoteControl, &inputHandler, &InputHandler::setRemoteControlState);
     QObject::connect(&cursorHandler, &CursorHandler::controlStateChanged, &inputSimulator, &InputSimulator::setControlState);
+    QObject::connect(&cursorHandler, &CursorHandler::controlStateChanged, &motionPlayout, &MotionPlayout::reset);
     cursorHandler.moveToThread(&cursorCheckerThread);
 
     DeviceConnectManager devConnectManager;
     devConnectManager.setPort(Settings.portTcp());
     devConnectManager.setUuid(Settings.uuid());
     devConnectManager.setKeyword(Settings.keyword());
+    devConnectManager.setStallDeadline(Settings.value(SharedCursor::KEY_STALL_DEADLINE, SharedCursor::DEFAULT_STALL_DEADLINE).toInt());
+    devConnectManager.setMotionBacklogLimit(Settings.value(SharedCursor::KEY_MOTION_BACKLOG_LIMIT, SharedCursor::DEFAULT_MOTION_BACKLOG_LIMIT).toInt());
 
     QThread devConnectManagerThread;
+    setupThread(devConnectManagerThread, SharedCursor::KEY_NETWORK);
     QObject::connect(&devConnectManagerThread, &QThread::started, &devConnectManager, &DeviceConnectManager::start);
     QObject::connect(&devConnectManagerThread, &QThread::finished, &devConnectManager, &DeviceConnectManager::stop);
     devConnectManager.moveToThread(&devConnectManagerThread);
@@ -84,39 +120,77 @@ int main(int argc, char *argv[])
     QObject::connect(&settingsWidget, &SettingsWidget::keywordChanged, &deviceSearch, &BroadcastDeviceSearch::setKeyword);
     QObject::connect(&deviceSearch, &BroadcastDeviceSearch::deviceFound, &Settings, &SettingsFacade::setDevice);
     QObject::connect(&Settings, &SettingsFacade::deviceFound, &devConnectManager, &DeviceConnectManager::connectToDevice);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::deviceInfo, &Settings, &SettingsFacade::setDevice);
     QObject::connect(&devConnectManager, &DeviceConnectManager::deviceConnectionChanged, &Settings, &SettingsFacade::setDeviceConnectionState);
+    QObject::connect(&Settings, &SettingsFacade::deviceLayoutOutdated, &devConnectManager, &DeviceConnectManager::requestDeviceInfo);
+    QObject::connect(&Settings, &SettingsFacade::deviceScreensChanged, &settingsWidget, &SettingsWidget::updateDeviceScreens);
     QObject::connect(&devConnectManager, &DeviceConnectManager::deviceConnectionChanged, &settingsWidget, &SettingsWidget::setDeviceConnectionState);
     QObject::connect(&devConnectManager, &DeviceConnectManager::deviceConnectionChanged, &cursorHandler, &CursorHandler::setConnectionState);
     QObject::connect(&settingsWidget, &SettingsWidget::removeDevice, &devConnectManager, &DeviceConnectManager::handleRemoveDevice);
     QObject::connect(&settingsWidget, &SettingsWidget::keywordChanged, &devConnectManager, &DeviceConnectManager::setKeyword);
-    QObject::connect(&settingsWidget, &SettingsWidget::devicesChanged, &cursorHandler, &CursorHandler::setDevices);
-    QObject::connect(&inputHandler, &InputHandler::message, &devConnectManager, &DeviceConnectManager::sendMessage);
-    QObject::connect(&cursorHandler, &CursorHandler::message, &devConnectManager, &DeviceConnectManager::sendMessage);
+    QObject::connect(&Settings, &SettingsFacade::topologyChanged, &cursorHandler, &CursorHandler::setTopology);
+    QObject::connect(&inputHandler, &InputHandler::message, &devConnectManager, qOverload<int, const SharedCursor::Message&>(&DeviceConnectManager::sendMessage));
+    // motion crosses threads without a posted event per message
+    QObject::connect(&cursorHandler, &CursorHandler::message, &devConnectManager, &DeviceConnectManager::postMessage, Qt::DirectConnection);
+    QObject::connect(&cursorHandler, &CursorHandler::jsonMessage, &devConnectManager, qOverload<const QUuid&, const QJsonObject&>(&DeviceConnectManager::sendMessage));
     QObject::connect(&cursorHandler, &CursorHandler::remoteControl, &devConnectManager, &DeviceConnectManager::sendRemoteControlMessage);
     QObject::connect(&cursorHandler, &CursorHandler::remoteControl, &inputHandler, &InputHandler::setRemoteControlState);
     QObject::connect(&cursorHandler, &CursorHandler::remoteControl, &clipboardHandler, &ClipboardHandler::setRemoteControlState);
     QObject::connect(&devConnectManager, &DeviceConnectManager::remoteControl, &cursorHandler, &CursorHandler::setRemoteControlState);
     QObject::connect(&devConnectManager, &DeviceConnectManager::remoteControl, &inputHandler, &InputHandler::setRemoteControlState);
     QObject::connect(&devConnectManager, &DeviceConnectManager::cursorPosition, &cursorHandler, &CursorHandler::setRemoteCursorPos);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorDelta, &cursorHandler, &CursorHandler::setRemoteCursorDelta);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorInitPosition, &inputSimulator, &InputSimulator::setCursorPosition);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorDelta, &inputSimulator, &InputSimulator::setCursorDelta);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::keyboardEvent, &inputSimulator, &InputSimulator::setKeyboardEvent);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::mouseEvent, &inputSimulator, &InputSimulator::setMouseEvent);
-    QObject::connect(&devConnectManager, &DeviceConnectManager::wheelEvent, &inputSimulator, &InputSimulator::setWheelEvent);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorDelta, &cursorHandler, &CursorHandler::setRemoteCursorDelta, Qt::DirectConnection);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::edgeCrossed, &cursorHandler, &CursorHandler::setRemoteEdgeCrossed);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::remoteTransits, &cursorHandler, &CursorHandler::setRemoteTransits);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorInitPosition, &inputSimulator, &InputSimulator::queueCursorPosition, Qt::DirectConnection);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::cursorDelta, &inputSimulator, &InputSimulator::queueCursorDelta, Qt::DirectConnection);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::keyboardEvent, &inputSimulator, &InputSimulator::queueKeyboardEvent, Qt::DirectConnection);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::mouseEvent, &inputSimulator, &InputSimulator::queueMouseEvent, Qt::DirectConnection);
+    QObject::connect(&devConnectManager, &DeviceConnectManager::wheelEvent, &inputSimulator, &InputSimulator::queueWheelEvent, Qt::DirectConnection);
     QObject::connect(&devConnectManager, &DeviceConnectManager::remoteControl, &clipboardHandler, &ClipboardHandler::setRemoteControlState);
     QObject::connect(&devConnectManager, &DeviceConnectManager::clipboard, &clipboardHandler, &ClipboardHandler::setClipboard);
-    QObject::connect(&clipboardHandler, &ClipboardHandler::message, &devConnectManager, &DeviceConnectManager::sendMessage);
+    QObject::connect(&clipboardHandler, &ClipboardHandler::message, &devConnectManager, qOverload<const QUuid&, const QJsonObject&>(&DeviceConnectManager::sendMessage));
 
     cursorCheckerThread.start();
     devConnectManagerThread.start();
+    inputSimulatorThread.start();
 
     Settings.loadDevices();
-    cursorHandler.setCurrentUuid(Settings.uuid());
-    cursorHandler.setDevices(Settings.devices());
+
+    // the handler owns timers and barriers on its thread
+    const QUuid uuid = Settings.uuid();
+    QMetaObject::invokeMethod(&cursorHandler, [&cursorHandler, uuid]() {
+        cursorHandler.setCurrentUuid(uuid);
+    }, Qt::QueuedConnection);
+    Settings.publishTopology();
+
+    const int statsInterval = Settings.value(SharedCursor::KEY_STATS_INTERVAL, SharedCursor::DEFAULT_STATS_INTERVAL).toInt();
+    quint64 lastInjectedEvents = 0;
+
+    // the counters are atomics, they are read here without stopping the threads
+    QTimer statsTimer;
+    QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+        const quint64 injectedEvents = inputSimulator.injectedEvents();
+        const quint64 injectedRate = (injectedEvents - lastInjectedEvents) * 1000 / statsInterval;
+        lastInjectedEvents = injectedEvents;
+
+        qDebug() << "stats"
+                 << "capture" << cursorHandler.captureRate() << "wakeups" << cursorHandler.wakeupRate()
+                 << "injection delay us" << inputSimulator.averageDelay() << inputSimulator.takeMaxDelay()
+                 << "merged input" << inputSimulator.mergedEvents() << "injected/s" << injectedRate
+                 << "playout" << motionPlayout.bufferDepth() << "delay ms" << motionPlayout.playoutDelay()
+                 << "late" << motionPlayout.latePackets()
+                 << "frames peak" << FramePool::takePeakOccupancy() << "acquired" << FramePool::takeAcquisitions()
+                 << "misses" << FramePool::misses()
+                 << "merged motion" << TcpSocket::mergedMotion();
+    });
+
+    if (statsInterval > 0)
+        statsTimer.start(statsInterval);
 
     int result = a.exec();
 
+    inputSimulatorThread.quit();
     devConnectManagerThread.quit();
     cursorCheckerThread.quit();
 
@@ -0,0 +1,37 @@
+#include <chrono>
+
+#include "monotonicclock.h"
+
+static MonotonicClock steadyClock;
+static std::atomic<MonotonicClock*> currentClock{&steadyClock};
+
+qint64 MonotonicClock::nsecs() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MonotonicClock &MonotonicClock::instance()
+{
+    return *currentClock.load(std::memory_order_acquire);
+}
+
+void MonotonicClock::setInstance(MonotonicClock *clock)
+{
+    currentClock.store(clock ? clock : &steadyClock, std::memory_order_release);
+}
+
+qint64 VirtualClock::nsecs() const
+{
+    return _nsecs;
+}
+
+void VirtualClock::setNsecs(qint64 nsecs)
+{
+    _nsecs = nsecs;
+}
+
+void VirtualClock::advance(qint64 nsecs)
+{
+    _nsecs += nsecs;
+}
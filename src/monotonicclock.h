@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+
+// time source of the input pipeline, never follows wall clock changes.
+// the current instance is process wide and can be replaced by a virtual clock
+class MonotonicClock
+{
+public:
+    virtual ~MonotonicClock() = default;
+
+    virtual qint64 nsecs() const;
+    qint64 msecs() const { return nsecs() / 1000000; }
+
+    static MonotonicClock &instance();
+    // nullptr restores the steady clock, the caller keeps ownership
+    static void setInstance(MonotonicClock *clock);
+};
+
+// only moves when told to
+class VirtualClock : public MonotonicClock
+{
+public:
+    qint64 nsecs() const override;
+
+    void setNsecs(qint64 nsecs);
+    void advance(qint64 nsecs);
+
+private:
+    std::atomic<qint64> _nsecs{0};
+};
+
+namespace SharedCursor
+{
+    inline qint64 monotonicNsecs() { return MonotonicClock::instance().nsecs(); }
+    inline qint64 monotonicMsecs() { return MonotonicClock::instance().msecs(); }
+};
@@ -1,9 +1,14 @@
+#include <QDataStream>
 #include <QJsonObject>
 #include <QDebug>
 
 #include "broadcastdevicesearch.h"
 #include "utils.h"
 
+static const int UUID_SIZE = 16;
+static const int MAX_NAME_SIZE = 64;
+static const int RECORD_HEADER_SIZE = 2 + UUID_SIZE + 4 + 2 + 1;
+
 BroadcastDeviceSearch::BroadcastDeviceSearch(QObject *parent)
     : QObject{parent}
 {
@@ -39,10 +44,7 @@ void BroadcastDeviceSearch::search()
 {
     qDebug() << Q_FUNC_INFO;
 
-    SharedCursor::fillDeviceJsonMessage(_jsonOut, SharedCursor::KEY_SEARCH_REQUEST);
-    SharedCursor::convertJsonToArray(_jsonOut, _datagram);
-    _sslWraper.encrypt(_datagram.constData(), _datagram.size(), _datagramEnc);
-    _udpSocket.writeDatagram(_datagramEnc, QHostAddress::Broadcast, _port);
+    sendRecord(SearchRequest, QHostAddress::Broadcast);
 }
 
 void BroadcastDeviceSearch::setPort(quint16 port)
@@ -54,7 +56,7 @@ void BroadcastDeviceSearch::setPort(quint16 port)
 void BroadcastDeviceSearch::setUuid(const QUuid &uuid)
 {
     qDebug() << Q_FUNC_INFO << uuid.toString();
-    _uuid = uuid.toString();
+    _uuid = uuid;
 }
 
 void BroadcastDeviceSearch::setKeyword(const QString &keyword)
@@ -63,6 +65,67 @@ void BroadcastDeviceSearch::setKeyword(const QString &keyword)
     _sslWraper.setKey(keyword.toLocal8Bit());
 }
 
+void BroadcastDeviceSearch::sendRecord(RecordType type, const QHostAddress &host)
+{
+    writeRecord(type, _datagram);
+    _sslWraper.encrypt(_datagram.constData(), _datagram.size(), _datagramEnc);
+    _udpSocket.writeDatagram(_datagramEnc, host, _port);
+}
+
+void BroadcastDeviceSearch::writeRecord(RecordType type, QByteArray &data)
+{
+    const QByteArray uuid = _uuid.toRfc4122();
+    const QByteArray name = Settings.name().toUtf8().left(MAX_NAME_SIZE);
+
+    data.clear();
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << SharedCursor::DISCOVERY_VERSION << quint8(type);
+    stream.writeRawData(uuid.constData(), UUID_SIZE);
+    stream << SharedCursor::screenListHash(Settings.screens()) << Settings.portTcp() << quint8(name.size());
+    stream.writeRawData(name.constData(), name.size());
+}
+
+bool BroadcastDeviceSearch::readRecord(const QByteArray &data, DiscoveryRecord &record)
+{
+    if (data.size() < RECORD_HEADER_SIZE)
+        return false;
+
+    QDataStream stream(data);
+    quint8 type = 0, nameSize = 0;
+    char uuid[UUID_SIZE];
+
+    stream >> record.version;
+    if (record.version != SharedCursor::DISCOVERY_VERSION)
+        return false;
+
+    stream >> type;
+    stream.readRawData(uuid, UUID_SIZE);
+    stream >> record.layoutHash >> record.portTcp >> nameSize;
+
+    QByteArray name(nameSize, Qt::Uninitialized);
+    if (stream.readRawData(name.data(), name.size()) != name.size())
+        return false;
+
+    if (stream.status() != QDataStream::Ok || type > SearchResponse)
+        return false;
+
+    record.type = static_cast<RecordType>(type);
+    record.uuid = QUuid::fromRfc4122(QByteArray::fromRawData(uuid, UUID_SIZE));
+    record.name = QString::fromUtf8(name);
+    return true;
+}
+
+QJsonObject BroadcastDeviceSearch::recordToJsonObject(const DiscoveryRecord &record, const QHostAddress &host)
+{
+    QJsonObject result;
+    result.insert(SharedCursor::KEY_UUID, record.uuid.toString());
+    result.insert(SharedCursor::KEY_NAME, record.name);
+    result.insert(SharedCursor::KEY_HOST, QHostAddress(host.toIPv4Address()).toString());
+    result.insert(SharedCursor::KEY_LAYOUT_HASH, qint64(record.layoutHash));
+    result.insert(SharedCursor::KEY_PORT_TCP, record.portTcp);
+    return result;
+}
+
 void BroadcastDeviceSearch::onSocketReadyRead()
 {
     QHostAddress senderHost;
@@ -79,45 +142,33 @@ void BroadcastDeviceSearch::onSocketReadyRead()
 
 void BroadcastDeviceSearch::onNewData(const QHostAddress &host, quint16 port, const QByteArray &data)
 {
-    _sslWraper.decrypt(data.constData(), data.size(), _datagram);
-    if (!SharedCursor::convertArrayToJson(_datagram, _jsonIn)) return;
+    if (!_sslWraper.decrypt(data.constData(), data.size(), _datagram)) return;
+    if (!readRecord(_datagram, _recordIn)) return;
+
+    if (_recordIn.uuid.isNull() || _recordIn.uuid == _uuid)
+        return;
 
-    qDebug() << Q_FUNC_INFO << host << port << _jsonIn;
-    QString type = _jsonIn.value(SharedCursor::KEY_TYPE).toString();
-    _jsonIn.insert(SharedCursor::KEY_HOST, QHostAddress(host.toIPv4Address()).toString());
+    qDebug() << Q_FUNC_INFO << host << port << _recordIn.uuid << _recordIn.name;
 
-    if (type == SharedCursor::KEY_SEARCH_REQUEST)
-        handleSearchRequest(host, _jsonIn);
-    else if (type == SharedCursor::KEY_SEARCH_RESPONSE)
-        handleSearchResponse(_jsonIn);
+    if (_recordIn.type == SearchRequest)
+        handleSearchRequest(host, _recordIn);
+    else if (_recordIn.type == SearchResponse)
+        handleSearchResponse(host, _recordIn);
 
     Q_UNUSED(port);
 }
 
-void BroadcastDeviceSearch::handleSearchRequest(const QHostAddress &host, const QJsonObject &jObject)
+void BroadcastDeviceSearch::handleSearchRequest(const QHostAddress &host, const DiscoveryRecord &record)
 {
     qDebug() << Q_FUNC_INFO;
 
-    if (!jObject.contains(SharedCursor::KEY_UUID) ||
-        !jObject.contains(SharedCursor::KEY_NAME))
-        return;
-
-    if (_uuid == jObject.value(SharedCursor::KEY_UUID).toString())
-        return;
-
-    SharedCursor::fillDeviceJsonMessage(_jsonOut, SharedCursor::KEY_SEARCH_RESPONSE);
-    SharedCursor::convertJsonToArray(_jsonOut, _datagram);
-
-    _sslWraper.encrypt(_datagram.constData(), _datagram.size(), _datagramEnc);
-    _udpSocket.writeDatagram(_datagramEnc, host, _port);
-    emit deviceFound(jObject);
+    sendRecord(SearchResponse, host);
+    emit deviceFound(recordToJsonObject(record, host));
 }
 
-void BroadcastDeviceSearch::handleSearchResponse(const QJsonObject &jObject)
+void BroadcastDeviceSearch::handleSearchResponse(const QHostAddress &host, const DiscoveryRecord &record)
 {
     qDebug() << Q_FUNC_INFO;
 
-    if (jObject.contains(SharedCursor::KEY_UUID) &&
-        jObject.contains(SharedCursor::KEY_NAME))
-        emit deviceFound(jObject);
+    emit deviceFound(recordToJsonObject(record, host));
 }
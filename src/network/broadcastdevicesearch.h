@@ -27,16 +27,36 @@ signals:
     void deviceFound(const QJsonObject& jObject);
 
 private:
+    enum RecordType : quint8 {
+        SearchRequest = 0,
+        SearchResponse
+    };
+
+    struct DiscoveryRecord
+    {
+        quint8 version = SharedCursor::DISCOVERY_VERSION;
+        RecordType type = SearchRequest;
+        QUuid uuid;
+        quint32 layoutHash = 0;
+        quint16 portTcp = SharedCursor::DEFAULT_TCP_PORT;
+        QString name;
+    };
+
     quint16 _port = SharedCursor::DEFAULT_UDP_PORT;
-    QString _uuid;
+    QUuid _uuid;
     QUdpSocket _udpSocket;
     OpenSslWrapper _sslWraper;
     QByteArray _datagram, _datagramEnc;
-    QJsonObject _jsonIn, _jsonOut;
+    DiscoveryRecord _recordIn;
+
+    void sendRecord(RecordType type, const QHostAddress &host);
+    void writeRecord(RecordType type, QByteArray &data);
+    bool readRecord(const QByteArray &data, DiscoveryRecord &record);
+    QJsonObject recordToJsonObject(const DiscoveryRecord &record, const QHostAddress &host);
+    void handleSearchRequest(const QHostAddress &host, const DiscoveryRecord &record);
+    void handleSearchResponse(const QHostAddress &host, const DiscoveryRecord &record);
 
 private slots:
     void onSocketReadyRead();
     void onNewData(const QHostAddress &host, quint16 port, const QByteArray &data);
-    void handleSearchRequest(const QHostAddress &host, const QJsonObject& jObject);
-    void handleSearchResponse(const QJsonObject& jObject);
 };
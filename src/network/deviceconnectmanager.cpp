@@ -1,13 +1,15 @@
+#include <QTimerEvent>
 #include <QJsonArray>
 
 #include "deviceconnectmanager.h"
+#include "monotonicclock.h"
+#include "devicetable.h"
 #include "utils.h"
 
 DeviceConnectManager::DeviceConnectManager(QObject *parent)
     : QObject{parent}
 {
     qDebug() << Q_FUNC_INFO;
-    _jsonRemoteControl[SharedCursor::KEY_TYPE] = SharedCursor::KEY_REMOTE_CONTROL;
 }
 
 DeviceConnectManager::~DeviceConnectManager()
@@ -33,9 +35,27 @@ void DeviceConnectManager::setKeyword(const QString &keyword)
     qDebug() << Q_FUNC_INFO;
     _keyword = keyword;
 
-    for (auto it = _devices.constBegin(); it != _devices.constEnd(); ++it) {
-        if (!it.value().isNull()) {
-            it.value()->setKeyword(_keyword);
+    for (const QSharedPointer<TcpSocket> &socket: std::as_const(_devices)) {
+        if (!socket.isNull()) {
+            socket->setKeyword(_keyword);
+        }
+    }
+}
+
+void DeviceConnectManager::setStallDeadline(int msec)
+{
+    qDebug() << Q_FUNC_INFO << msec;
+    _stallDeadline = qMax(0, msec);
+}
+
+void DeviceConnectManager::setMotionBacklogLimit(int bytes)
+{
+    qDebug() << Q_FUNC_INFO << bytes;
+    _motionBacklogLimit = qMax(0, bytes);
+
+    for (const QSharedPointer<TcpSocket> &socket: std::as_const(_devices)) {
+        if (!socket.isNull()) {
+            socket->setMotionBacklogLimit(_motionBacklogLimit);
         }
     }
 }
@@ -52,6 +72,11 @@ void DeviceConnectManager::start()
 
     connect(_server.get(), &TcpServer::newSocketConnected, this, &DeviceConnectManager::onSocketConnected);
 
+    connect(&_wakeupNotifier, &WakeupNotifier::activated, this, &DeviceConnectManager::sendPostedMessages, Qt::UniqueConnection);
+    _wakeupNotifier.start();
+
+    _timerId = startTimer(SharedCursor::ROUTE_UPDATE_INTERVAL);
+
     emit started();
 }
 
@@ -61,8 +86,22 @@ void DeviceConnectManager::stop()
 
     disconnect(_server.get(), &TcpServer::newSocketConnected, this, &DeviceConnectManager::onSocketConnected);
 
+    sendPostedMessages();
+    _wakeupNotifier.stop();
+
+    if (_timerId) {
+        killTimer(_timerId);
+        _timerId = 0;
+    }
+
+    setControlledDevice(QUuid());
+    _stalledHandle = -1;
+    _lastReceived.clear();
     _devices.clear();
     _server.clear();
+    _routes.clear();
+    _advertisedRoutes.clear();
+    _latencies.clear();
 
     emit finished();
 }
@@ -75,14 +114,14 @@ void DeviceConnectManager::connectToDevice(const QUuid &uuid, const QHostAddress
         return;
     }
 
-    auto it = _devices.find(uuid);
-    if (it != _devices.end()) {
-        QSharedPointer<TcpSocket> socket = _devices.value(uuid);
-        if(!socket.isNull() && socket->isConnected()) {
+    const int handle = DeviceTable::handle(uuid);
+    QSharedPointer<TcpSocket> existing = deviceSocket(handle);
+    if (!existing.isNull()) {
+        if (existing->isConnected()) {
             emit deviceConnectionChanged(uuid, SharedCursor::Connected);
             return;
         } else {
-            it.value().clear();
+            _devices[handle].clear();
         }
     }
 
@@ -97,33 +136,112 @@ void DeviceConnectManager::connectToDevice(const QUuid &uuid, const QHostAddress
     emit deviceConnectionChanged(uuid, SharedCursor::Waiting);
 }
 
+void DeviceConnectManager::postMessage(int handle, const SharedCursor::Message &message)
+{
+    PostedMessage posted;
+    posted.handle = handle;
+    posted.message = message;
+
+    // the network thread is far behind, the slow path keeps the message
+    if (!_postedMessages.push(posted)) {
+        QMetaObject::invokeMethod(this, [this, handle, message]() {
+            sendMessage(handle, message);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    // before start the queue is drained by a posted event
+    if (!_wakeupNotifier.wakeUp())
+        QMetaObject::invokeMethod(this, &DeviceConnectManager::sendPostedMessages, Qt::QueuedConnection);
+}
+
+void DeviceConnectManager::sendPostedMessages()
+{
+    PostedMessage posted;
+    while (_postedMessages.pop(posted)) {
+        deliverMessage(posted.handle, posted.message);
+    }
+}
+
 void DeviceConnectManager::sendMessage(const QUuid &uuid, const QJsonObject &json)
 {
-    auto it = _devices.find(uuid);
-    if (it != _devices.end() && !it.value().isNull()) {
-        it.value()->sendMessage(json);
+    // json from the cursor thread must not overtake the messages it posted before
+    sendPostedMessages();
+
+    const QSharedPointer<TcpSocket> &socket = deviceSocket(uuid);
+    if (!socket.isNull() && socket->isConnected()) {
+        socket->sendMessage(json);
+    }
+    else if (_routes.contains(uuid)) {
+        relayMessage(_uuid, uuid, 0, json);
     }
 }
 
-void DeviceConnectManager::sendRemoteControlMessage(const QUuid &master, const QUuid &slave)
+void DeviceConnectManager::sendMessage(int handle, const SharedCursor::Message &message)
+{
+    // a button from the gui thread must not overtake the motion that led to it
+    sendPostedMessages();
+    deliverMessage(handle, message);
+}
+
+void DeviceConnectManager::deliverMessage(int handle, const SharedCursor::Message &message)
 {
-    _jsonRemoteControl[SharedCursor::KEY_MASTER] = master.toString();
-    _jsonRemoteControl[SharedCursor::KEY_SLAVE] = slave.toString();
+    const QSharedPointer<TcpSocket> &socket = deviceSocket(handle);
+    if (!socket.isNull() && socket->isConnected()) {
+        socket->sendMessage(message);
+        return;
+    }
+
+    // the uuid is only needed once the direct link is gone
+    const QUuid &uuid = DeviceTable::uuid(handle);
+    if (_routes.contains(uuid)) {
+        relayMessage(_uuid, uuid, 0, message);
+    }
+}
 
-    for (auto it = _devices.constBegin(); it != _devices.constEnd(); ++it) {
-        if (it.key() != _uuid && !it.value().isNull()) {
-            it.value()->sendMessage(_jsonRemoteControl);
+void DeviceConnectManager::sendRemoteControlMessage(const QUuid &master, const QUuid &slave)
+{
+    SharedCursor::Message message;
+    message.type = SharedCursor::Message::RemoteControl;
+    message.master = master;
+    message.slave = slave;
+
+    // motion posted before the switch still goes to the previous device
+    sendPostedMessages();
+    setControlledDevice(master == _uuid && slave != _uuid ? slave : QUuid());
+
+    const int ownHandle = DeviceTable::handle(_uuid);
+    for (int handle=0; handle<_devices.size(); ++handle) {
+        if (handle != ownHandle && !_devices.at(handle).isNull()) {
+            _devices.at(handle)->sendMessage(message);
         }
     }
+
+    if (_routes.isEmpty())
+        return;
+
+    for (auto it = _routes.constBegin(); it != _routes.constEnd(); ++it) {
+        relayMessage(_uuid, it.key(), 0, message);
+    }
+}
+
+void DeviceConnectManager::requestDeviceInfo(const QUuid &uuid)
+{
+    qDebug() << Q_FUNC_INFO << uuid;
+
+    _jsonDeviceInfo = QJsonObject();
+    _jsonDeviceInfo.insert(SharedCursor::KEY_TYPE, SharedCursor::KEY_DEVICE_INFO_REQUEST);
+    sendMessage(uuid, _jsonDeviceInfo);
 }
 
 void DeviceConnectManager::handleRemoveDevice(const QUuid &uuid)
 {
     qDebug() << Q_FUNC_INFO;
-    if (!_devices.contains(uuid))
+    const int handle = DeviceTable::handle(uuid);
+    if (handle < 0 || handle >= _devices.size())
         return;
 
-    _devices.remove(uuid);
+    _devices[handle].clear();
 }
 
 void DeviceConnectManager::handleDeviceConnected(TcpSocket *socket, const QJsonObject &json)
@@ -136,19 +254,31 @@ void DeviceConnectManager::handleDeviceConnected(TcpSocket *socket, const QJsonO
     if (socketPtr.isNull())
         return;
 
-    auto it = _devices.find(uuid);
-    if (it != _devices.end()) {
-        if (!it.value()->isConnected()) {
-            it.value().swap(socketPtr);
+    const int handle = DeviceTable::allocate(uuid);
+    if (handle < 0) {
+        disconnectSocket(socketPtr);
+        return;
+    }
+
+    socketPtr->setHandle(handle);
+
+    const QSharedPointer<TcpSocket> &existing = deviceSocket(handle);
+    if (!existing.isNull()) {
+        if (!existing->isConnected()) {
+            _devices[handle].swap(socketPtr);
+            emit deviceInfo(json);
             emit deviceConnectionChanged(uuid, SharedCursor::Connected);
         }
         else {
             disconnectSocket(socketPtr);
         }
     } else {
-        _devices.insert(uuid, socketPtr);
+        setDeviceSocket(handle, socketPtr);
+        emit deviceInfo(json);
         emit deviceConnectionChanged(uuid, SharedCursor::Connected);
     }
+
+    updateRoutes();
 }
 
 void DeviceConnectManager::handleDeviceDisconnected(TcpSocket *socket)
@@ -160,10 +290,17 @@ void DeviceConnectManager::handleDeviceDisconnected(TcpSocket *socket)
 
     qDebug() << Q_FUNC_INFO << uuid;
 
-    auto it = _devices.find(uuid);
-    if (it != _devices.end()) {
-        disconnectSocket(it.value());
+    const QSharedPointer<TcpSocket> &existing = deviceSocket(uuid);
+    if (!existing.isNull()) {
+        disconnectSocket(existing);
         emit deviceConnectionChanged(uuid, SharedCursor::Disconnected);
+
+        if (existing->handle() == _stalledHandle)
+            _stalledHandle = -1;
+
+        _latencies.remove(uuid);
+        _advertisedRoutes.remove(uuid);
+        updateRoutes();
     }
     else {
         popTempSocket(socket);
@@ -180,41 +317,378 @@ void DeviceConnectManager::onSocketConnected(qintptr socketDescriptor)
 
 void DeviceConnectManager::onMessageReceived(const QUuid &uuid, const QJsonObject &json)
 {
+    markReceived(DeviceTable::handle(uuid));
+
     const QString &type = json.value(SharedCursor::KEY_TYPE).toString();
 
-    if (type == SharedCursor::KEY_REMOTE_CONTROL) {
-        emit remoteControl(QUuid::fromString(json.value(SharedCursor::KEY_MASTER).toString()),
-                           QUuid::fromString(json.value(SharedCursor::KEY_SLAVE).toString()));
+    if (type == SharedCursor::KEY_EDGES) {
+        emit remoteTransits(SharedCursor::jsonValueToTransitList(json.value(SharedCursor::KEY_TRANSITS)));
+    }
+    else if (type == SharedCursor::KEY_CLIPBOARD) {
+        emit clipboard(uuid, json);
+    }
+    else if (type == SharedCursor::KEY_DEVICE_INFO_REQUEST) {
+        SharedCursor::fillDeviceJsonMessage(_jsonDeviceInfo, SharedCursor::KEY_DEVICE_INFO);
+        sendMessage(uuid, _jsonDeviceInfo);
     }
-    else if (type == SharedCursor::KEY_INIT_CURSOR_POS) {
-        const QJsonValue &value = json.value(SharedCursor::KEY_VALUE);
-        emit cursorInitPosition(SharedCursor::jsonValueToPoint(value));
+    else if (type == SharedCursor::KEY_DEVICE_INFO) {
+        emit deviceInfo(json);
     }
-    else if (type == SharedCursor::KEY_CURSOR_POS) {
-        const QJsonValue &value = json.value(SharedCursor::KEY_VALUE);
-        emit cursorPosition(SharedCursor::jsonValueToPoint(value));
+    else if (type == SharedCursor::KEY_RELAY) {
+        handleRelay(uuid, json);
     }
-    else if (type == SharedCursor::KEY_CURSOR_DELTA) {
-        const QJsonValue &value = json.value(SharedCursor::KEY_VALUE);
-        emit cursorDelta(SharedCursor::jsonValueToPoint(value));
+    else if (type == SharedCursor::KEY_ROUTES) {
+        handleRoutes(uuid, json);
     }
-    else if (type == SharedCursor::KEY_INPUT) {
-        const QJsonValue &inputType = json.value(SharedCursor::KEY_INPUT);
-        int value = json.value(SharedCursor::KEY_VALUE).toInt();
+    else if (type == SharedCursor::KEY_PING) {
+        _jsonPing = json;
+        _jsonPing[SharedCursor::KEY_TYPE] = SharedCursor::KEY_PONG;
+        sendMessage(uuid, _jsonPing);
+    }
+    else if (type == SharedCursor::KEY_PONG) {
+        handlePong(uuid, json);
+    }
+    // fixed schema messages arrive as json only when relayed
+    else if (SharedCursor::decodeJson(type, json, _messageIn)) {
+        handleMessage(_messageIn);
+    }
+}
 
-        if (inputType == SharedCursor::KEY_KEYBOARD) {
-            emit keyboardEvent(value, json.value(SharedCursor::KEY_PRESSED).toBool());
-        }
-        else if (inputType == SharedCursor::KEY_MOUSE) {
-            emit mouseEvent(value, json.value(SharedCursor::KEY_PRESSED).toBool());
+void DeviceConnectManager::onBinaryMessageReceived(int handle, const SharedCursor::Message &message)
+{
+    markReceived(handle);
+    handleMessage(message);
+}
+
+void DeviceConnectManager::handleMessage(const SharedCursor::Message &message)
+{
+    switch (message.type) {
+    case SharedCursor::Message::RemoteControl:
+        if (message.master != _uuid)
+            setControlledDevice(QUuid());
+        emit remoteControl(message.master, message.slave);
+        break;
+    case SharedCursor::Message::InitCursorPos:
+        emit cursorInitPosition(message.point);
+        break;
+    case SharedCursor::Message::CursorPos:
+        emit cursorPosition(message.point);
+        break;
+    case SharedCursor::Message::CursorDelta:
+        emit cursorDelta(message.point);
+        break;
+    case SharedCursor::Message::CrossedEdge:
+        emit edgeCrossed(message.point);
+        break;
+    case SharedCursor::Message::Keyboard:
+        emit keyboardEvent(message.value, message.pressed);
+        break;
+    case SharedCursor::Message::Mouse:
+        emit mouseEvent(message.value, message.pressed);
+        break;
+    case SharedCursor::Message::Wheel:
+        emit wheelEvent(message.value, message.horizontal);
+        break;
+    default:
+        break;
+    }
+}
+
+void DeviceConnectManager::timerEvent(QTimerEvent *e)
+{
+    if (e->timerId() == _stallTimerId) {
+        checkStall();
+        return;
+    }
+
+    if (e->timerId() != _timerId)
+        return;
+
+    _jsonPing = QJsonObject();
+    _jsonPing[SharedCursor::KEY_TYPE] = SharedCursor::KEY_PING;
+    _jsonPing[SharedCursor::KEY_TIME] = SharedCursor::monotonicMsecs();
+
+    for (int handle=0; handle<_devices.size(); ++handle) {
+        const QSharedPointer<TcpSocket> &socket = _devices.at(handle);
+        if (socket.isNull() || !socket->isConnected())
+            continue;
+
+        socket->sendMessage(_jsonPing);
+        sendRoutes(DeviceTable::uuid(handle), socket);
+    }
+}
+
+void DeviceConnectManager::markReceived(int handle)
+{
+    if (handle < 0)
+        return;
+
+    if (_lastReceived.size() <= handle)
+        _lastReceived.resize(handle + 1);
+    _lastReceived[handle] = SharedCursor::monotonicMsecs();
+
+    if (handle == _stalledHandle) {
+        const QUuid &uuid = DeviceTable::uuid(handle);
+        qDebug() << Q_FUNC_INFO << "stall recovered" << uuid;
+        _stalledHandle = -1;
+        emit deviceConnectionChanged(uuid, SharedCursor::Connected);
+    }
+}
+
+qint64 DeviceConnectManager::receivedAge(int handle) const
+{
+    if (handle < 0 || handle >= _lastReceived.size())
+        return 0;
+
+    return SharedCursor::monotonicMsecs() - _lastReceived.at(handle);
+}
+
+void DeviceConnectManager::setControlledDevice(const QUuid &uuid)
+{
+    if (uuid == _controlledUuid)
+        return;
+
+    _controlledUuid = uuid;
+    _controlledHandle = DeviceTable::handle(uuid);
+
+    if (_stallTimerId) {
+        killTimer(_stallTimerId);
+        _stallTimerId = 0;
+    }
+
+    if (_controlledUuid.isNull() || !_stallDeadline)
+        return;
+
+    // the deadline counts from taking control, not from the last message before it
+    markReceived(_controlledHandle);
+    _stallTimerId = startTimer(qMax(10, _stallDeadline / 4), Qt::PreciseTimer);
+}
+
+void DeviceConnectManager::checkStall()
+{
+    if (_controlledUuid.isNull())
+        return;
+
+    // a slave that only receives motion has nothing to answer, the heartbeat asks it to
+    if (receivedAge(_controlledHandle) <= _stallDeadline) {
+        _jsonPing = QJsonObject();
+        _jsonPing[SharedCursor::KEY_TYPE] = SharedCursor::KEY_PING;
+        _jsonPing[SharedCursor::KEY_TIME] = SharedCursor::monotonicMsecs();
+        sendMessage(_controlledUuid, _jsonPing);
+        return;
+    }
+
+    qDebug() << Q_FUNC_INFO << "stalled" << _controlledUuid << receivedAge(_controlledHandle);
+
+    // cursor handler returns to self control on any state other than connected
+    const QUuid stalled = _controlledUuid;
+    _stalledHandle = _controlledHandle;
+    setControlledDevice(QUuid());
+    emit deviceConnectionChanged(stalled, SharedCursor::Waiting);
+}
+
+QSharedPointer<TcpSocket> DeviceConnectManager::deviceSocket(const QUuid &uuid) const
+{
+    return deviceSocket(DeviceTable::handle(uuid));
+}
+
+QSharedPointer<TcpSocket> DeviceConnectManager::deviceSocket(int handle) const
+{
+    return handle >= 0 && handle < _devices.size() ? _devices.at(handle) : QSharedPointer<TcpSocket>();
+}
+
+void DeviceConnectManager::setDeviceSocket(int handle, QSharedPointer<TcpSocket> socket)
+{
+    if (_devices.size() <= handle)
+        _devices.resize(handle + 1);
+    _devices[handle] = socket;
+}
+
+bool DeviceConnectManager::isDirectlyConnected(const QUuid &uuid) const
+{
+    const QSharedPointer<TcpSocket> &socket = deviceSocket(uuid);
+    return !socket.isNull() && socket->isConnected();
+}
+
+void DeviceConnectManager::sendRoutes(const QUuid &uuid, QSharedPointer<TcpSocket> socket)
+{
+    QJsonArray routes;
+
+    for (int handle=0; handle<_devices.size(); ++handle) {
+        const QSharedPointer<TcpSocket> &socket = _devices.at(handle);
+        const QUuid &device = DeviceTable::uuid(handle);
+        if (device == uuid || socket.isNull() || !socket->isConnected())
+            continue;
+
+        QJsonObject route;
+        route.insert(SharedCursor::KEY_UUID, device.toString());
+        route.insert(SharedCursor::KEY_HOPS, 1);
+        route.insert(SharedCursor::KEY_LATENCY, _latencies.value(device, SharedCursor::ROUTE_UPDATE_INTERVAL));
+        routes.append(route);
+    }
+
+    // split horizon: never advertise a route back to its next hop
+    for (auto it = _routes.constBegin(); it != _routes.constEnd(); ++it) {
+        if (it.key() == uuid || it.value().nextHop == uuid)
+            continue;
+
+        QJsonObject route;
+        route.insert(SharedCursor::KEY_UUID, it.key().toString());
+        route.insert(SharedCursor::KEY_HOPS, it.value().hops);
+        route.insert(SharedCursor::KEY_LATENCY, it.value().latency);
+        routes.append(route);
+    }
+
+    QJsonObject json;
+    json.insert(SharedCursor::KEY_TYPE, SharedCursor::KEY_ROUTES);
+    json.insert(SharedCursor::KEY_ROUTES, routes);
+    socket->sendMessage(json);
+}
+
+void DeviceConnectManager::handleRoutes(const QUuid &uuid, const QJsonObject &json)
+{
+    if (!isDirectlyConnected(uuid))
+        return;
+
+    QMap<QUuid, Route> &advertised = _advertisedRoutes[uuid];
+    advertised.clear();
+
+    const QJsonArray routes = json.value(SharedCursor::KEY_ROUTES).toArray();
+    for (const QJsonValue &value: routes) {
+        const QJsonObject &obj = value.toObject();
+
+        Route route;
+        route.nextHop = uuid;
+        route.hops = obj.value(SharedCursor::KEY_HOPS).toInt();
+        route.latency = obj.value(SharedCursor::KEY_LATENCY).toInt();
+        advertised.insert(QUuid::fromString(obj.value(SharedCursor::KEY_UUID).toString()), route);
+    }
+
+    updateRoutes();
+}
+
+void DeviceConnectManager::handlePong(const QUuid &uuid, const QJsonObject &json)
+{
+    int latency = static_cast<int>(SharedCursor::monotonicMsecs() - json.value(SharedCursor::KEY_TIME).toDouble());
+    if (latency < 0)
+        return;
+
+    auto it = _latencies.find(uuid);
+    if (it != _latencies.end()) {
+        it.value() = (it.value() * 3 + latency) / 4;
+    }
+    else {
+        _latencies.insert(uuid, latency);
+    }
+}
+
+void DeviceConnectManager::handleRelay(const QUuid &uuid, const QJsonObject &json)
+{
+    const QUuid &source = QUuid::fromString(json.value(SharedCursor::KEY_SOURCE).toString());
+    const QUuid &target = QUuid::fromString(json.value(SharedCursor::KEY_TARGET).toString());
+    const QJsonObject &value = json.value(SharedCursor::KEY_VALUE).toObject();
+
+    // the source field is only trusted when the frame came the way our own route to it goes
+    if (source.isNull() || source == _uuid || (source != uuid && _routes.value(source).nextHop != uuid)) {
+        qDebug() << Q_FUNC_INFO << "dropped relay from" << source << "via" << uuid;
+        return;
+    }
+
+    // a relay is never wrapped into another one
+    if (value.value(SharedCursor::KEY_TYPE).toString() == SharedCursor::KEY_RELAY)
+        return;
+
+    if (target == _uuid) {
+        onMessageReceived(source, value);
+    }
+    else {
+        relayMessage(source, target, json.value(SharedCursor::KEY_HOPS).toInt(), value);
+    }
+}
+
+void DeviceConnectManager::relayMessage(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json)
+{
+    const QSharedPointer<TcpSocket> &socket = relaySocket(target, hops);
+    if (!socket.isNull())
+        socket->sendRelayMessage(source, target, hops + 1, json);
+}
+
+void DeviceConnectManager::relayMessage(const QUuid &source, const QUuid &target, int hops, const SharedCursor::Message &message)
+{
+    const QSharedPointer<TcpSocket> &socket = relaySocket(target, hops);
+    if (!socket.isNull())
+        socket->sendRelayMessage(source, target, hops + 1, message);
+}
+
+QSharedPointer<TcpSocket> DeviceConnectManager::relaySocket(const QUuid &target, int hops) const
+{
+    if (hops >= SharedCursor::MAX_RELAY_HOPS)
+        return QSharedPointer<TcpSocket>();
+
+    QSharedPointer<TcpSocket> socket = deviceSocket(target);
+    if (socket.isNull() || !socket->isConnected()) {
+        auto it = _routes.find(target);
+        if (it == _routes.end())
+            return QSharedPointer<TcpSocket>();
+
+        socket = deviceSocket(it.value().nextHop);
+    }
+
+    return socket;
+}
+
+void DeviceConnectManager::updateRoutes()
+{
+    QMap<QUuid, Route> routes;
+
+    for (auto it = _advertisedRoutes.constBegin(); it != _advertisedRoutes.constEnd(); ++it) {
+        if (!isDirectlyConnected(it.key()))
+            continue;
+
+        const int linkLatency = _latencies.value(it.key(), SharedCursor::ROUTE_UPDATE_INTERVAL);
+        const QMap<QUuid, Route> &advertised = it.value();
+
+        for (auto routeIt = advertised.constBegin(); routeIt != advertised.constEnd(); ++routeIt) {
+            const QUuid &target = routeIt.key();
+            if (target.isNull() || target == _uuid || isDirectlyConnected(target))
+                continue;
+
+            Route route;
+            route.nextHop = it.key();
+            route.hops = routeIt.value().hops + 1;
+            route.latency = linkLatency + routeIt.value().latency;
+
+            if (route.hops > SharedCursor::MAX_RELAY_HOPS)
+                continue;
+
+            // the lowest latency path wins, hop count breaks ties
+            auto bestIt = routes.find(target);
+            if (bestIt == routes.end()) {
+                routes.insert(target, route);
+            }
+            else if (route.latency < bestIt.value().latency ||
+                     (route.latency == bestIt.value().latency && route.hops < bestIt.value().hops)) {
+                bestIt.value() = route;
+            }
         }
-        else if (inputType == SharedCursor::KEY_WHEEL) {
-            emit wheelEvent(value);
+    }
+
+    for (auto it = _routes.constBegin(); it != _routes.constEnd(); ++it) {
+        if (!routes.contains(it.key()) && !isDirectlyConnected(it.key())) {
+            qDebug() << Q_FUNC_INFO << "route lost" << it.key();
+            emit deviceConnectionChanged(it.key(), SharedCursor::Disconnected);
         }
     }
-    else if (type == SharedCursor::KEY_CLIPBOARD) {
-        emit clipboard(uuid, json);
+
+    for (auto it = routes.constBegin(); it != routes.constEnd(); ++it) {
+        if (!_routes.contains(it.key())) {
+            qDebug() << Q_FUNC_INFO << "route found" << it.key() << "via" << it.value().nextHop
+                     << it.value().hops << it.value().latency;
+            emit deviceConnectionChanged(it.key(), SharedCursor::Connected);
+        }
     }
+
+    _routes = routes;
 }
 
 QJsonObject DeviceConnectManager::devicePtrToJsonObject(QSharedPointer<SharedCursor::Device> device)
@@ -243,10 +717,13 @@ QSharedPointer<TcpSocket> DeviceConnectManager::createSocket()
 {
     QSharedPointer<TcpSocket> socket = QSharedPointer<TcpSocket>(new TcpSocket);
     socket->setKeyword(_keyword);
+    socket->setMotionBacklogLimit(_motionBacklogLimit);
 
     connect(socket.get(), &TcpSocket::deviceConnected, this, &DeviceConnectManager::handleDeviceConnected, Qt::QueuedConnection);
     connect(socket.get(), &TcpSocket::deviceDisconnected, this, &DeviceConnectManager::handleDeviceDisconnected, Qt::QueuedConnection);
-    connect(socket.get(), &TcpSocket::message, this, &DeviceConnectManager::onMessageReceived, Qt::QueuedConnection);
+    // both sides live on this thread, a direct call keeps arrival order without posting events
+    connect(socket.get(), &TcpSocket::message, this, &DeviceConnectManager::onMessageReceived, Qt::DirectConnection);
+    connect(socket.get(), &TcpSocket::binaryMessage, this, &DeviceConnectManager::onBinaryMessageReceived, Qt::DirectConnection);
 
     return socket;
 }
@@ -256,6 +733,7 @@ void DeviceConnectManager::disconnectSocket(QSharedPointer<TcpSocket> socket)
     disconnect(socket.get(), &TcpSocket::deviceConnected, this, &DeviceConnectManager::handleDeviceConnected);
     disconnect(socket.get(), &TcpSocket::deviceDisconnected, this, &DeviceConnectManager::handleDeviceDisconnected);
     disconnect(socket.get(), &TcpSocket::message, this, &DeviceConnectManager::onMessageReceived);
+    disconnect(socket.get(), &TcpSocket::binaryMessage, this, &DeviceConnectManager::onBinaryMessageReceived);
 }
 
 void DeviceConnectManager::pushTempSocket(QSharedPointer<TcpSocket> socket)
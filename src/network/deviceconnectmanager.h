@@ -4,8 +4,11 @@
 #include <QJsonObject>
 #include <QObject>
 
+#include "wakeupnotifier.h"
 #include "tcpsocket.h"
 #include "tcpserver.h"
+#include "spscqueue.h"
+#include "message.h"
 #include "global.h"
 
 class DeviceConnectManager : public QObject
@@ -18,6 +21,12 @@ public:
     void setPort(quint16 port);
     void setUuid(const QUuid &uuid);
     void setKeyword(const QString &keyword);
+    void setStallDeadline(int msec);
+    void setMotionBacklogLimit(int bytes);
+
+    // thread safe for one producer thread, the cursor thread calls it directly.
+    // messages are handed over without posting an event
+    void postMessage(int handle, const SharedCursor::Message &message);
 
 public slots:
     void start();
@@ -25,7 +34,9 @@ public slots:
     void connectToDevice(const QUuid &uuid, const QHostAddress &host);
 
     void sendMessage(const QUuid &uuid, const QJsonObject &json);
+    void sendMessage(int handle, const SharedCursor::Message &message);
     void sendRemoteControlMessage(const QUuid &master, const QUuid &slave);
+    void requestDeviceInfo(const QUuid &uuid);
 
     void handleRemoveDevice(const QUuid &uuid);
     void handleDeviceConnected(TcpSocket* socket, const QJsonObject &json);
@@ -36,28 +47,86 @@ signals:
     void finished();
 
     void deviceConnectionChanged(const QUuid &uuid, SharedCursor::ConnectionState state);
+    void deviceInfo(const QJsonObject &json);
     void remoteControl(const QUuid &master, const QUuid &slave);
     void cursorPosition(const QPoint &pos);
     void cursorInitPosition(const QPoint &pos);
     void cursorDelta(const QPoint &pos);
+    void edgeCrossed(const QPoint &pos);
+    void remoteTransits(const QVector<SharedCursor::Transit> &transits);
     void keyboardEvent(int keycode, bool state);
     void mouseEvent(int button, bool state);
-    void wheelEvent(int delta);
+    void wheelEvent(int delta, int horizontalDelta);
     void clipboard(const QUuid &uuid, const QJsonObject &json);
 
 private slots:
     void onSocketConnected(qintptr socketDescriptor);
     void onMessageReceived(const QUuid &uuid, const QJsonObject &json);
+    void onBinaryMessageReceived(int handle, const SharedCursor::Message &message);
 
 private:
+    struct PostedMessage
+    {
+        int handle = -1;
+        SharedCursor::Message message;
+    };
+
+    struct Route
+    {
+        QUuid nextHop;
+        int hops = 0;
+        int latency = 0;
+    };
+
     QUuid _uuid;
     QString _keyword;
-    QJsonObject _jsonRemoteControl;
+    QJsonObject _jsonDeviceInfo, _jsonPing;
+    SharedCursor::Message _messageIn;
     quint16 _port = SharedCursor::DEFAULT_TCP_PORT;
-    QMap<QUuid, QSharedPointer<TcpSocket>> _devices;
+    // indexed by device handle
+    QVector<QSharedPointer<TcpSocket>> _devices;
     QVector<QSharedPointer<TcpSocket>> _tempSockets;
     QSharedPointer<TcpServer> _server;
 
+    int _timerId = 0;
+    QMap<QUuid, int> _latencies;
+    QMap<QUuid, QMap<QUuid, Route>> _advertisedRoutes;
+    QMap<QUuid, Route> _routes;
+
+    int _stallTimerId = 0;
+    int _stallDeadline = SharedCursor::DEFAULT_STALL_DEADLINE;
+    int _motionBacklogLimit = SharedCursor::DEFAULT_MOTION_BACKLOG_LIMIT;
+    QUuid _controlledUuid;
+    int _controlledHandle = -1;
+    int _stalledHandle = -1;
+    // indexed by device handle
+    QVector<qint64> _lastReceived;
+
+    static const int POSTED_MESSAGES_SIZE = 256;
+    SpscQueue<PostedMessage, POSTED_MESSAGES_SIZE> _postedMessages;
+    WakeupNotifier _wakeupNotifier{this};
+
+    void timerEvent(QTimerEvent *e) final;
+    void handleMessage(const SharedCursor::Message &message);
+    void sendPostedMessages();
+    void deliverMessage(int handle, const SharedCursor::Message &message);
+    void markReceived(int handle);
+    qint64 receivedAge(int handle) const;
+    void setControlledDevice(const QUuid &uuid);
+    void checkStall();
+    QSharedPointer<TcpSocket> deviceSocket(const QUuid &uuid) const;
+    QSharedPointer<TcpSocket> deviceSocket(int handle) const;
+    void setDeviceSocket(int handle, QSharedPointer<TcpSocket> socket);
+    bool isDirectlyConnected(const QUuid &uuid) const;
+    void sendRoutes(const QUuid &uuid, QSharedPointer<TcpSocket> socket);
+    void handleRoutes(const QUuid &uuid, const QJsonObject &json);
+    void handlePong(const QUuid &uuid, const QJsonObject &json);
+    void handleRelay(const QUuid &uuid, const QJsonObject &json);
+    void relayMessage(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json);
+    void relayMessage(const QUuid &source, const QUuid &target, int hops, const SharedCursor::Message &message);
+    QSharedPointer<TcpSocket> relaySocket(const QUuid &target, int hops) const;
+    void updateRoutes();
+
     QJsonObject devicePtrToJsonObject(QSharedPointer<SharedCursor::Device> device);
     QSharedPointer<SharedCursor::Device> jsonObjectToDevicePtr(const QJsonObject &obj);
 
@@ -0,0 +1,114 @@
+#include <atomic>
+
+#include "framepool.h"
+
+static std::atomic<int> poolOccupancy{0};
+static std::atomic<int> poolPeakOccupancy{0};
+static std::atomic<quint64> poolAcquisitions{0};
+static std::atomic<quint64> poolMisses{0};
+
+FramePool::Frame::Frame(Frame &&other)
+{
+    *this = std::move(other);
+}
+
+FramePool::Frame &FramePool::Frame::operator=(Frame &&other)
+{
+    if (this != &other) {
+        release();
+        _pool = other._pool;
+        _data = other._data;
+        _capacity = other._capacity;
+        other._pool = nullptr;
+        other._data = nullptr;
+        other._capacity = 0;
+    }
+    return *this;
+}
+
+FramePool::Frame::~Frame()
+{
+    release();
+}
+
+void FramePool::Frame::release()
+{
+    if (_pool && _data)
+        _pool->release(_data);
+
+    _pool = nullptr;
+    _data = nullptr;
+    _capacity = 0;
+}
+
+FramePool::FramePool()
+    : _storage(new char[FRAME_CAPACITY * POOL_SIZE])
+{
+    _free.reserve(POOL_SIZE);
+    for (int i=POOL_SIZE - 1; i>=0; --i) {
+        _free.append(_storage.get() + i * FRAME_CAPACITY);
+    }
+}
+
+FramePool &FramePool::local()
+{
+    thread_local FramePool pool;
+    return pool;
+}
+
+FramePool::Frame FramePool::acquire(int size)
+{
+    Frame frame;
+    frame._pool = this;
+    ++poolAcquisitions;
+
+    if (size <= FRAME_CAPACITY && !_free.isEmpty()) {
+        frame._data = _free.takeLast();
+        frame._capacity = FRAME_CAPACITY;
+
+        // frames rarely outlive a write, only the high water mark is worth sampling
+        const int occupancy = ++poolOccupancy;
+        int peak = poolPeakOccupancy.load(std::memory_order_relaxed);
+        while (occupancy > peak && !poolPeakOccupancy.compare_exchange_weak(peak, occupancy, std::memory_order_relaxed)) {}
+    }
+    else {
+        frame._data = new char[size];
+        frame._capacity = size;
+        ++poolMisses;
+    }
+
+    return frame;
+}
+
+int FramePool::takePeakOccupancy()
+{
+    // the next interval starts from the frames still held
+    return poolPeakOccupancy.exchange(poolOccupancy);
+}
+
+quint64 FramePool::takeAcquisitions()
+{
+    return poolAcquisitions.exchange(0);
+}
+
+quint64 FramePool::misses()
+{
+    return poolMisses;
+}
+
+void FramePool::release(char *data)
+{
+    if (isPooled(data)) {
+        _free.append(data);
+        --poolOccupancy;
+    }
+    else {
+        delete[] data;
+    }
+}
+
+bool FramePool::isPooled(const char *data) const
+{
+    const char *begin = _storage.get();
+    return data >= begin && data < begin + FRAME_CAPACITY * POOL_SIZE;
+}
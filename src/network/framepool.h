@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+#include <memory>
+
+// per thread pool of fixed capacity buffers for socket frames.
+// frames larger than the capacity or requested while the pool is drained are heap allocated and counted as misses
+class FramePool
+{
+public:
+    static const int FRAME_CAPACITY = 4096;
+    static const int POOL_SIZE = 16;
+
+    class Frame
+    {
+    public:
+        Frame() = default;
+        Frame(Frame &&other);
+        Frame &operator=(Frame &&other);
+        ~Frame();
+
+        Frame(const Frame&) = delete;
+        Frame &operator=(const Frame&) = delete;
+
+        char *data() const { return _data; }
+        int capacity() const { return _capacity; }
+
+    private:
+        friend class FramePool;
+
+        FramePool *_pool = nullptr;
+        char *_data = nullptr;
+        int _capacity = 0;
+
+        void release();
+    };
+
+    static FramePool &local();
+
+    Frame acquire(int size);
+
+    // totals over the pools of all threads, the peak and the acquisitions are reset when taken
+    static int takePeakOccupancy();
+    static quint64 takeAcquisitions();
+    static quint64 misses();
+
+private:
+    FramePool();
+
+    std::unique_ptr<char[]> _storage;
+    QVector<char*> _free;
+
+    void release(char *data);
+    bool isPooled(const char *data) const;
+};
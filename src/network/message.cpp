@@ -0,0 +1,181 @@
+#include <QtEndian>
+#include <cstring>
+
+#include "message.h"
+#include "utils.h"
+
+static const int UUID_SIZE = 16;
+
+static char *writeInt(char *out, qint32 value)
+{
+    qToBigEndian(value, out);
+    return out + sizeof(qint32);
+}
+
+static const char *readInt(const char *in, qint32 &value)
+{
+    value = qFromBigEndian<qint32>(in);
+    return in + sizeof(qint32);
+}
+
+static char *writeUuid(char *out, const QUuid &uuid)
+{
+    qToBigEndian(uuid.data1, out);
+    qToBigEndian(uuid.data2, out + 4);
+    qToBigEndian(uuid.data3, out + 6);
+    memcpy(out + 8, uuid.data4, 8);
+    return out + UUID_SIZE;
+}
+
+static const char *readUuid(const char *in, QUuid &uuid)
+{
+    const uchar *b = reinterpret_cast<const uchar*>(in + 8);
+    uuid = QUuid(qFromBigEndian<quint32>(in), qFromBigEndian<quint16>(in + 4), qFromBigEndian<quint16>(in + 6),
+                 b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
+    return in + UUID_SIZE;
+}
+
+static int binarySize(quint8 fields)
+{
+    int size = 2;
+    if (fields & SharedCursor::FieldPoint) size += 2 * sizeof(qint32);
+    if (fields & SharedCursor::FieldValue) size += sizeof(qint32);
+    if (fields & SharedCursor::FieldHorizontal) size += sizeof(qint32);
+    if (fields & SharedCursor::FieldPressed) size += 1;
+    if (fields & SharedCursor::FieldControl) size += 2 * UUID_SIZE;
+    return size;
+}
+
+int SharedCursor::encodeBinary(const Message &message, char *buffer)
+{
+    if (message.type == Message::Invalid || message.type >= Message::TypeCount)
+        return 0;
+
+    const quint8 fields = MESSAGE_SCHEMA[message.type].fields;
+    char *out = buffer;
+    *out++ = BINARY_MESSAGE_TAG;
+    *out++ = static_cast<char>(message.type);
+
+    if (fields & FieldPoint) {
+        out = writeInt(out, message.point.x());
+        out = writeInt(out, message.point.y());
+    }
+    if (fields & FieldValue)
+        out = writeInt(out, message.value);
+    if (fields & FieldHorizontal)
+        out = writeInt(out, message.horizontal);
+    if (fields & FieldPressed)
+        *out++ = message.pressed ? 1 : 0;
+    if (fields & FieldControl) {
+        out = writeUuid(out, message.master);
+        out = writeUuid(out, message.slave);
+    }
+
+    return static_cast<int>(out - buffer);
+}
+
+bool SharedCursor::decodeBinary(const char *data, int size, Message &message)
+{
+    if (size < 2 || data[0] != BINARY_MESSAGE_TAG)
+        return false;
+
+    const quint8 type = static_cast<quint8>(data[1]);
+    if (type == Message::Invalid || type >= Message::TypeCount)
+        return false;
+
+    const quint8 fields = MESSAGE_SCHEMA[type].fields;
+    if (size < binarySize(fields))
+        return false;
+
+    message.type = static_cast<Message::Type>(type);
+    const char *in = data + 2;
+    qint32 x = 0, y = 0;
+
+    if (fields & FieldPoint) {
+        in = readInt(in, x);
+        in = readInt(in, y);
+        message.point = QPoint(x, y);
+    }
+    if (fields & FieldValue)
+        in = readInt(in, message.value);
+    if (fields & FieldHorizontal)
+        in = readInt(in, message.horizontal);
+    if (fields & FieldPressed)
+        message.pressed = *in++ != 0;
+    if (fields & FieldControl) {
+        in = readUuid(in, message.master);
+        in = readUuid(in, message.slave);
+    }
+
+    return true;
+}
+
+static void setJsonField(QJsonObject &json, const char *key, bool used, const QJsonValue &value)
+{
+    // latin1 keys are looked up without building a QString
+    const QLatin1String latin1Key(key);
+
+    if (used)
+        json[latin1Key] = value;
+    else if (json.contains(latin1Key))
+        json.remove(QString(latin1Key));
+}
+
+void SharedCursor::encodeJson(const Message &message, QJsonObject &json)
+{
+    if (message.type == Message::Invalid || message.type >= Message::TypeCount) {
+        json = QJsonObject();
+        return;
+    }
+
+    // the object is reused by the caller, fields of the previous type are removed, the others
+    // are overwritten in place
+    const MessageSchema &schema = MESSAGE_SCHEMA[message.type];
+    const quint8 fields = schema.fields;
+
+    setJsonField(json, KEY_TYPE, true, QLatin1String(schema.jsonType));
+    setJsonField(json, KEY_INPUT, schema.jsonInput, QLatin1String(schema.jsonInput));
+    setJsonField(json, KEY_VALUE, fields & (FieldPoint | FieldValue),
+                 fields & FieldPoint ? pointToJsonValue(message.point) : QJsonValue(message.value));
+    setJsonField(json, KEY_HORIZONTAL, fields & FieldHorizontal, message.horizontal);
+    setJsonField(json, KEY_PRESSED, fields & FieldPressed, message.pressed);
+    setJsonField(json, KEY_MASTER, fields & FieldControl, fields & FieldControl ? message.master.toString() : QString());
+    setJsonField(json, KEY_SLAVE, fields & FieldControl, fields & FieldControl ? message.slave.toString() : QString());
+}
+
+bool SharedCursor::decodeJson(const QJsonObject &json, Message &message)
+{
+    return decodeJson(json.value(KEY_TYPE).toString(), json, message);
+}
+
+bool SharedCursor::decodeJson(const QString &type, const QJsonObject &json, Message &message)
+{
+    const QString &input = json.value(KEY_INPUT).toString();
+
+    for (int i=1; i<Message::TypeCount; ++i) {
+        const MessageSchema &schema = MESSAGE_SCHEMA[i];
+        if (type != QLatin1String(schema.jsonType))
+            continue;
+        if (schema.jsonInput && input != QLatin1String(schema.jsonInput))
+            continue;
+
+        message.type = schema.type;
+
+        if (schema.fields & FieldPoint)
+            message.point = jsonValueToPoint(json.value(KEY_VALUE));
+        if (schema.fields & FieldValue)
+            message.value = json.value(KEY_VALUE).toInt();
+        if (schema.fields & FieldHorizontal)
+            message.horizontal = json.value(KEY_HORIZONTAL).toInt();
+        if (schema.fields & FieldPressed)
+            message.pressed = json.value(KEY_PRESSED).toBool();
+        if (schema.fields & FieldControl) {
+            message.master = QUuid::fromString(json.value(KEY_MASTER).toString());
+            message.slave = QUuid::fromString(json.value(KEY_SLAVE).toString());
+        }
+
+        return true;
+    }
+
+    return false;
+}
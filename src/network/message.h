@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QPoint>
+#include <QUuid>
+
+#include "global.h"
+
+namespace SharedCursor
+{
+    // fixed schema messages sent on every motion or input event
+    struct Message
+    {
+        enum Type : quint8 {
+            Invalid = 0,
+            InitCursorPos,
+            CursorPos,
+            CursorDelta,
+            Keyboard,
+            Mouse,
+            Wheel,
+            RemoteControl,
+            CrossedEdge,
+            TypeCount
+        };
+
+        Type type = Invalid;
+        QPoint point;
+        int value = 0;
+        int horizontal = 0;
+        bool pressed = false;
+        QUuid master;
+        QUuid slave;
+    };
+
+    enum MessageField : quint8 {
+        FieldPoint = 0x01,
+        FieldValue = 0x02,
+        FieldHorizontal = 0x04,
+        FieldPressed = 0x08,
+        FieldControl = 0x10
+    };
+
+    struct MessageSchema
+    {
+        Message::Type type;
+        const char *jsonType;
+        const char *jsonInput;
+        quint8 fields;
+    };
+
+    // the single definition both encodings are driven by, indexed by Message::Type
+    inline const MessageSchema MESSAGE_SCHEMA[Message::TypeCount] = {
+        {Message::Invalid, nullptr, nullptr, 0},
+        {Message::InitCursorPos, KEY_INIT_CURSOR_POS, nullptr, FieldPoint},
+        {Message::CursorPos, KEY_CURSOR_POS, nullptr, FieldPoint},
+        {Message::CursorDelta, KEY_CURSOR_DELTA, nullptr, FieldPoint},
+        {Message::Keyboard, KEY_INPUT, KEY_KEYBOARD, FieldValue | FieldPressed},
+        {Message::Mouse, KEY_INPUT, KEY_MOUSE, FieldValue | FieldPressed},
+        {Message::Wheel, KEY_INPUT, KEY_WHEEL, FieldValue | FieldHorizontal},
+        {Message::RemoteControl, KEY_REMOTE_CONTROL, nullptr, FieldControl},
+        {Message::CrossedEdge, KEY_CROSSED_EDGE, nullptr, FieldPoint}
+    };
+
+    // json payloads always start with '{', binary ones with this tag
+    inline const char BINARY_MESSAGE_TAG = 0x01;
+    inline const int MAX_BINARY_MESSAGE_SIZE = 64;
+
+    int encodeBinary(const Message &message, char *buffer);
+    bool decodeBinary(const char *data, int size, Message &message);
+
+    void encodeJson(const Message &message, QJsonObject &json);
+    bool decodeJson(const QJsonObject &json, Message &message);
+    bool decodeJson(const QString &type, const QJsonObject &json, Message &message);
+};
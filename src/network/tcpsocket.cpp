@@ -1,16 +1,27 @@
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QtEndian>
 #include <QDebug>
+#include <atomic>
+
+#if defined(Q_OS_LINUX)
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#endif
 
 #include "tcpsocket.h"
+#include "framepool.h"
 #include "utils.h"
 
 static const int sizeofInt32 = 4;
 
+static std::atomic<quint64> motionMerges{0};
+
 TcpSocket::TcpSocket(QObject *parent)
     : QTcpSocket{parent}
 {
     connect(this, &QTcpSocket::readyRead, this, &TcpSocket::onReadyRead);
+    connect(this, &QTcpSocket::bytesWritten, this, &TcpSocket::onBytesWritten);
     connect(this, &QTcpSocket::connected, this, &TcpSocket::onConnected);
     connect(this, &QTcpSocket::disconnected, this, &TcpSocket::onDisconnected);
 }
@@ -20,6 +31,7 @@ TcpSocket::~TcpSocket()
     qDebug() << Q_FUNC_INFO;
 
     disconnect(this, &QTcpSocket::readyRead, this, &TcpSocket::onReadyRead);
+    disconnect(this, &QTcpSocket::bytesWritten, this, &TcpSocket::onBytesWritten);
     disconnect(this, &QTcpSocket::connected, this, &TcpSocket::onConnected);
     disconnect(this, &QTcpSocket::disconnected, this, &TcpSocket::onDisconnected);
 
@@ -47,11 +59,26 @@ QUuid TcpSocket::getUuid() const
     return _uuid;
 }
 
+void TcpSocket::setHandle(int handle)
+{
+    _handle = handle;
+}
+
+int TcpSocket::handle() const
+{
+    return _handle;
+}
+
 void TcpSocket::setKeyword(const QString &keyword)
 {
     _sslWraper.setKey(keyword.toLocal8Bit());
 }
 
+void TcpSocket::setMotionBacklogLimit(int bytes)
+{
+    _motionBacklogLimit = bytes;
+}
+
 bool TcpSocket::isConnected() const
 {
     return _isConnected;
@@ -85,6 +112,8 @@ void TcpSocket::stop()
     qDebug() << Q_FUNC_INFO;
 
     _isConnected = false;
+    clearMotion();
+    clearMotionFrames();
 
     if (state() == QTcpSocket::ConnectedState)
         disconnectFromHost();
@@ -95,28 +124,257 @@ void TcpSocket::stop()
 void TcpSocket::sendMessage(const QJsonObject &json)
 {
     if (state() == QTcpSocket::ConnectedState) {
-        SharedCursor::convertJsonToArray(json, _dataOut);
-        _sslWraper.encrypt(_dataOut.constData(), _dataOut.size(), _dataOutEnc);
-        appendDataSizeToOutBuffer();
-        write(_dataOutEnc);
+        // motion held back before this message goes first
+        flushMotion();
+        writeJson(json);
+    }
+}
+
+void TcpSocket::sendMessage(const SharedCursor::Message &message)
+{
+    if (state() != QTcpSocket::ConnectedState)
+        return;
+
+    OutgoingMessage outgoing;
+    outgoing.message = message;
+    queueMessage(outgoing);
+}
+
+void TcpSocket::sendRelayMessage(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json)
+{
+    if (state() != QTcpSocket::ConnectedState)
+        return;
+
+    // relayed motion is merged under backlog like the direct one
+    const QString &type = json.value(SharedCursor::KEY_TYPE).toString();
+    if ((type == SharedCursor::KEY_CURSOR_DELTA || type == SharedCursor::KEY_CURSOR_POS || type == SharedCursor::KEY_INIT_CURSOR_POS) &&
+        SharedCursor::decodeJson(type, json, _relayMessage)) {
+        sendRelayMessage(source, target, hops, _relayMessage);
+        return;
     }
+
+    flushMotion();
+    writeRelay(source, target, hops, json);
 }
 
-void TcpSocket::appendDataSizeToOutBuffer()
+void TcpSocket::sendRelayMessage(const QUuid &source, const QUuid &target, int hops, const SharedCursor::Message &message)
 {
-    int size = _dataOutEnc.size();
-    _dataOutEnc.resize(size + sizeofInt32);
-    qToBigEndian(size, _dataOutEnc.data() + size);
+    if (state() != QTcpSocket::ConnectedState)
+        return;
+
+    OutgoingMessage outgoing;
+    outgoing.message = message;
+    outgoing.source = source;
+    outgoing.target = target;
+    outgoing.hops = hops;
+    queueMessage(outgoing);
 }
 
-void TcpSocket::extractDataSizesFromInputData()
+quint64 TcpSocket::mergedMotion()
+{
+    return motionMerges;
+}
+
+void TcpSocket::queueMessage(const OutgoingMessage &outgoing)
+{
+    if (isMotion(outgoing.message)) {
+        // stale motion is useless after a stall, only its sum or the latest position is kept.
+        // other payloads do not count, a large clipboard must not hold motion back
+        if (motionBacklog() > _motionBacklogLimit) {
+            mergeMotion(outgoing);
+            return;
+        }
+
+        // the backlog cleared, motion held back goes first
+        flushMotion();
+    }
+    else {
+        // keys and buttons are never merged, motion held back before them goes first
+        flushMotion();
+    }
+
+    writeMessage(outgoing);
+}
+
+void TcpSocket::writeMessage(const OutgoingMessage &outgoing)
+{
+    const qint64 start = _writtenBytes;
+
+    if (!outgoing.target.isNull()) {
+        // relays wrap the payload in json, the binary form only goes over direct links
+        SharedCursor::encodeJson(outgoing.message, _jsonRelayValue);
+        writeRelay(outgoing.source, outgoing.target, outgoing.hops, _jsonRelayValue);
+    }
+    else {
+        char buffer[SharedCursor::MAX_BINARY_MESSAGE_SIZE];
+        const int size = SharedCursor::encodeBinary(outgoing.message, buffer);
+        if (size)
+            writeFrame(buffer, size);
+    }
+
+    if (isMotion(outgoing.message) && _writtenBytes > start)
+        addMotionFrame(_writtenBytes - start);
+}
+
+void TcpSocket::writeRelay(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json)
+{
+    _jsonRelay[SharedCursor::KEY_TYPE] = SharedCursor::KEY_RELAY;
+    _jsonRelay[SharedCursor::KEY_SOURCE] = source.toString();
+    _jsonRelay[SharedCursor::KEY_TARGET] = target.toString();
+    _jsonRelay[SharedCursor::KEY_HOPS] = hops;
+    _jsonRelay[SharedCursor::KEY_VALUE] = json;
+
+    writeJson(_jsonRelay);
+}
+
+bool TcpSocket::isMotion(const SharedCursor::Message &message) const
+{
+    return message.type == SharedCursor::Message::CursorDelta ||
+           message.type == SharedCursor::Message::CursorPos ||
+           message.type == SharedCursor::Message::InitCursorPos;
+}
+
+bool TcpSocket::hasPendingMotion() const
+{
+    return !_pendingMotion.isEmpty();
+}
+
+void TcpSocket::mergeMotion(const OutgoingMessage &outgoing)
+{
+    if (hasPendingMotion())
+        ++motionMerges;
+
+    const bool absolute = outgoing.message.type != SharedCursor::Message::CursorDelta;
+    int last = -1;
+
+    // held motion keeps its arrival order, merging only happens within one route
+    for (int i=_pendingMotion.size() - 1; i>=0; --i) {
+        const OutgoingMessage &pending = _pendingMotion.at(i);
+        if (pending.source != outgoing.source || pending.target != outgoing.target)
+            continue;
+
+        // a newer absolute position makes held deltas and the older position of its kind stale
+        if (absolute && (pending.message.type == SharedCursor::Message::CursorDelta || pending.message.type == outgoing.message.type)) {
+            _pendingMotion.remove(i);
+            continue;
+        }
+
+        if (last < 0)
+            last = i;
+    }
+
+    if (!absolute && last >= 0 && _pendingMotion.at(last).message.type == SharedCursor::Message::CursorDelta) {
+        _pendingMotion[last].message.point += outgoing.message.point;
+        return;
+    }
+
+    _pendingMotion.append(outgoing);
+}
+
+void TcpSocket::flushMotion()
+{
+    if (!hasPendingMotion())
+        return;
+
+    for (const OutgoingMessage &pending: std::as_const(_pendingMotion)) {
+        writeMessage(pending);
+    }
+
+    clearMotion();
+}
+
+void TcpSocket::clearMotion()
+{
+    _pendingMotion.clear();
+}
+
+void TcpSocket::addMotionFrame(int size)
+{
+    // a full history extends the newest entry, the total stays exact
+    if (_motionFrameCount == MOTION_FRAME_HISTORY) {
+        MotionFrame &last = _motionFrames[(_motionFrameFirst + _motionFrameCount - 1) % MOTION_FRAME_HISTORY];
+        last.end = _writtenBytes;
+        last.size += size;
+    }
+    else {
+        MotionFrame &frame = _motionFrames[(_motionFrameFirst + _motionFrameCount) % MOTION_FRAME_HISTORY];
+        frame.end = _writtenBytes;
+        frame.size = size;
+        ++_motionFrameCount;
+    }
+
+    _motionBytes += size;
+}
+
+void TcpSocket::clearMotionFrames()
+{
+    _motionFrameFirst = 0;
+    _motionFrameCount = 0;
+    _motionBytes = 0;
+}
+
+qint64 TcpSocket::motionBacklog()
+{
+    if (!_motionFrameCount)
+        return 0;
+
+    // frames before this offset were acknowledged by the peer
+    const qint64 acknowledged = _writtenBytes - unsentBytes();
+
+    while (_motionFrameCount && _motionFrames[_motionFrameFirst].end <= acknowledged) {
+        _motionBytes -= _motionFrames[_motionFrameFirst].size;
+        _motionFrameFirst = (_motionFrameFirst + 1) % MOTION_FRAME_HISTORY;
+        --_motionFrameCount;
+    }
+
+    return _motionBytes;
+}
+
+qint64 TcpSocket::unsentBytes() const
+{
+    qint64 result = bytesToWrite();
+
+#if defined(Q_OS_LINUX)
+    // the kernel send queue, a stall shows up here long before it fills
+    int queued = 0;
+    if (ioctl(int(socketDescriptor()), SIOCOUTQ, &queued) == 0)
+        result += queued;
+#endif
+
+    return result;
+}
+
+void TcpSocket::writeJson(const QJsonObject &json)
+{
+    // json only carries control messages, its text is dropped once it is in a frame
+    const QByteArray data = QJsonDocument(json).toJson(QJsonDocument::Compact);
+    writeFrame(data.constData(), data.size());
+}
+
+void TcpSocket::writeFrame(const char *data, int size)
+{
+    // encrypted in place into a pooled frame with the size trailer appended,
+    // the only copy left is the one into the socket write buffer
+    FramePool::Frame frame = FramePool::local().acquire(OpenSslWrapper::encryptedSize(size) + sizeofInt32);
+
+    const int length = _sslWraper.encrypt(data, size, frame.data(), frame.capacity() - sizeofInt32);
+    if (length < 0)
+        return;
+
+    qToBigEndian(length, frame.data() + length);
+    const qint64 written = write(frame.data(), length + sizeofInt32);
+    if (written > 0)
+        _writtenBytes += written;
+}
+
+void TcpSocket::extractDataSizesFromInputData(const char *data, int dataSize)
 {
     _dataSizes.clear();
-    int size = _dataIn.size();
+    int size = dataSize;
 
-    for(int i=0; i<_dataIn.size(); ++i) {
+    for(int i=0; i<dataSize; ++i) {
         if (size > sizeofInt32) {
-            int length = qFromBigEndian<quint32>(_dataIn.data() + (size - sizeofInt32));
+            int length = qFromBigEndian<quint32>(data + (size - sizeofInt32));
             if (length + sizeofInt32 <= size) {
                 _dataSizes.push(length);
                 size -= length + sizeofInt32;
@@ -128,10 +386,18 @@ void TcpSocket::extractDataSizesFromInputData()
     }
 }
 
-void TcpSocket::parseInputData(const QByteArray &data)
+void TcpSocket::parseInputData(const char *data, int size)
 {
-    if (!SharedCursor::convertArrayToJson(data, _jsonIn)) {
-        qDebug() << Q_FUNC_INFO << "ERROR: Json parsing!" << _dataInDec;
+    if (size > 0 && data[0] == SharedCursor::BINARY_MESSAGE_TAG) {
+        if (_isConnected && SharedCursor::decodeBinary(data, size, _messageIn))
+            emit binaryMessage(_handle, _messageIn);
+        return;
+    }
+
+    // the parser reads the pooled frame directly
+    const QByteArray &json = QByteArray::fromRawData(data, size);
+    if (!SharedCursor::convertArrayToJson(json, _jsonIn)) {
+        qDebug() << Q_FUNC_INFO << "ERROR: Json parsing!" << json;
         return;
     }
 
@@ -160,19 +426,31 @@ void TcpSocket::parseInputData(const QByteArray &data)
 
 void TcpSocket::onReadyRead()
 {
-    _dataIn.resize(bytesAvailable());
-    read(_dataIn.data(), _dataIn.size());
-    extractDataSizesFromInputData();
+    const int available = static_cast<int>(bytesAvailable());
+    FramePool::Frame input = FramePool::local().acquire(available);
+    const int received = static_cast<int>(read(input.data(), available));
+    if (received <= 0)
+        return;
+
+    extractDataSizesFromInputData(input.data(), received);
 
     int step = 0;
     while (!_dataSizes.isEmpty()) {
         int size = _dataSizes.pop();
-        _sslWraper.decrypt(_dataIn.data() + step, size, _dataInDec);
-        parseInputData(_dataInDec);
+        FramePool::Frame output = FramePool::local().acquire(size);
+        const int length = _sslWraper.decrypt(input.data() + step, size, output.data(), output.capacity());
+        if (length >= 0)
+            parseInputData(output.data(), length);
         step += size + sizeofInt32;
     }
 }
 
+void TcpSocket::onBytesWritten()
+{
+    if (hasPendingMotion() && motionBacklog() <= _motionBacklogLimit)
+        flushMotion();
+}
+
 void TcpSocket::onConnected()
 {
     SharedCursor::fillDeviceJsonMessage(_jsonOut, SharedCursor::KEY_CONNECT_REQUEST);
@@ -181,6 +459,9 @@ void TcpSocket::onConnected()
 
 void TcpSocket::onDisconnected()
 {
+    clearMotion();
+    clearMotionFrames();
+
     if (_isConnected) {
         _isConnected = false;
         emit deviceDisconnected(this);
@@ -2,11 +2,14 @@
 
 #include <QSharedPointer>
 #include <QTcpSocket>
+#include <QVarLengthArray>
 #include <QJsonObject>
 #include <QStack>
 #include <QUuid>
+#include <array>
 
 #include "opensslwrapper.h"
+#include "message.h"
 #include "global.h"
 
 class TcpSocket : public QTcpSocket
@@ -27,10 +30,17 @@ public:
     bool isUuidEqual(const QUuid &uuid) const;
     QUuid getUuid() const;
 
+    void setHandle(int handle);
+    int handle() const;
+
     void setKeyword(const QString &keyword);
+    void setMotionBacklogLimit(int bytes);
 
     bool isConnected() const;
 
+    // total over all sockets
+    static quint64 mergedMotion();
+
     friend bool operator==(const QUuid& uuid, const TcpSocket& socket) {
         return uuid == socket._uuid;
     }
@@ -39,6 +49,7 @@ signals:
     void deviceConnected(TcpSocket* self, const QJsonObject &json);
     void deviceDisconnected(TcpSocket* self);
     void message(const QUuid &uuid, const QJsonObject &json);
+    void binaryMessage(int handle, const SharedCursor::Message &message);
 
 public slots:
     void setUuid(const QUuid &uuid);
@@ -49,26 +60,67 @@ public slots:
     void stop();
 
     void sendMessage(const QJsonObject &json);
+    void sendMessage(const SharedCursor::Message &message);
+    void sendRelayMessage(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json);
+    void sendRelayMessage(const QUuid &source, const QUuid &target, int hops, const SharedCursor::Message &message);
 
 private:
+    // a message for the peer itself or, with a target set, relayed through it
+    struct OutgoingMessage
+    {
+        SharedCursor::Message message;
+        QUuid source;
+        QUuid target;
+        int hops = 0;
+    };
+
     QUuid _uuid;
+    int _handle = -1;
     QHostAddress _host;
     quint16 _port = SharedCursor::DEFAULT_TCP_PORT;
     bool _isConnected = false;
-    QByteArray _dataIn, _dataInDec;
-    QByteArray _dataOut, _dataOutEnc;
-    QJsonObject _jsonIn, _jsonOut;
+    QJsonObject _jsonIn, _jsonOut, _jsonRelay, _jsonRelayValue;
+    SharedCursor::Message _messageIn, _relayMessage;
+    QVarLengthArray<OutgoingMessage, 4> _pendingMotion;
+
+    // end offsets in the written stream of motion frames the peer has not acknowledged yet
+    struct MotionFrame
+    {
+        qint64 end = 0;
+        int size = 0;
+    };
+    static const int MOTION_FRAME_HISTORY = 64;
+    std::array<MotionFrame, MOTION_FRAME_HISTORY> _motionFrames;
+    int _motionFrameFirst = 0;
+    int _motionFrameCount = 0;
+    qint64 _motionBytes = 0;
+    qint64 _writtenBytes = 0;
+    qint64 _motionBacklogLimit = SharedCursor::DEFAULT_MOTION_BACKLOG_LIMIT;
     QString _messageType;
     QStack<int> _dataSizes;
     OpenSslWrapper _sslWraper;
     TcpSocket::Type _type = TcpSocket::Type::Independent;
 
-    void appendDataSizeToOutBuffer();
-    void extractDataSizesFromInputData();
-    void parseInputData(const QByteArray &data);
+    void queueMessage(const OutgoingMessage &outgoing);
+    void writeMessage(const OutgoingMessage &outgoing);
+    void writeRelay(const QUuid &source, const QUuid &target, int hops, const QJsonObject &json);
+    void writeJson(const QJsonObject &json);
+    void writeFrame(const char *data, int size);
+    bool isMotion(const SharedCursor::Message &message) const;
+    bool hasPendingMotion() const;
+    void mergeMotion(const OutgoingMessage &outgoing);
+    void flushMotion();
+    void clearMotion();
+    void addMotionFrame(int size);
+    void clearMotionFrames();
+    qint64 motionBacklog();
+    qint64 unsentBytes() const;
+    void extractDataSizesFromInputData(const char *data, int size);
+    void parseInputData(const char *data, int size);
 
 private slots:
     void onReadyRead();
+    void onBytesWritten();
     void onConnected();
     void onDisconnected();
     void onConnectRequestReceived();
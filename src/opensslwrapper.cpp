@@ -6,6 +6,11 @@
 static const int BLOCK_SIZE = 16;
 static const int EVP_KEY_SIZE = 32;
 
+void OpenSslWrapper::ContextDeleter::operator()(evp_cipher_ctx_st *context) const
+{
+    EVP_CIPHER_CTX_free(context);
+}
+
 void OpenSslWrapper::setKey(const QByteArray &key)
 {
     _key.resize(EVP_KEY_SIZE);
@@ -14,52 +19,86 @@ void OpenSslWrapper::setKey(const QByteArray &key)
 
     _iv = "\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39\x30\x31\x32\x33\x34\x35";
     std::copy(key.data(), key.data() + ((key.size() < _iv.size()) ? key.size() : _iv.size()), _iv.begin());
+
+    if (!_encryptContext)
+        _encryptContext.reset(EVP_CIPHER_CTX_new());
+    if (!_decryptContext)
+        _decryptContext.reset(EVP_CIPHER_CTX_new());
+
+    _keyed = _encryptContext && _decryptContext &&
+             EVP_EncryptInit_ex(_encryptContext.get(), EVP_aes_256_cbc(), NULL,
+                                reinterpret_cast<const unsigned char*>(_key.constData()),
+                                reinterpret_cast<const unsigned char*>(_iv.constData())) == 1 &&
+             EVP_DecryptInit_ex(_decryptContext.get(), EVP_aes_256_cbc(), NULL,
+                                reinterpret_cast<const unsigned char*>(_key.constData()),
+                                reinterpret_cast<const unsigned char*>(_iv.constData())) == 1;
 }
 
 bool OpenSslWrapper::encrypt(const char *input, int size, QByteArray &output)
 {
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), ::EVP_CIPHER_CTX_free);
+    output.resize(encryptedSize(size));
+    const int length = encrypt(input, size, output.data(), output.size());
+    if (length < 0) return false;
 
-    int rc = EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL,
-                                reinterpret_cast<const unsigned char*>(_key.constData()),
-                                reinterpret_cast<const unsigned char*>(_iv.constData()));
-    if (rc != 1) return false;
+    output.resize(length);
+    return true;
+}
 
-    output.resize(size + BLOCK_SIZE);
-    int out_len1 = output.size();
+bool OpenSslWrapper::decrypt(const char *input, int size, QByteArray &output)
+{
+    output.resize(size);
+    const int length = decrypt(input, size, output.data(), output.size());
+    if (length < 0) return false;
 
-    rc = EVP_EncryptUpdate(ctx.get(), reinterpret_cast<unsigned char*>(output.data()), &out_len1,
+    output.resize(length);
+    return true;
+}
+
+int OpenSslWrapper::encrypt(const char *input, int size, char *output, int capacity)
+{
+    if (capacity < encryptedSize(size) || !_keyed) return -1;
+
+    EVP_CIPHER_CTX *ctx = _encryptContext.get();
+
+    int rc = EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, reinterpret_cast<const unsigned char*>(_iv.constData()));
+    if (rc != 1) return -1;
+
+    int out_len1 = capacity;
+
+    rc = EVP_EncryptUpdate(ctx, reinterpret_cast<unsigned char*>(output), &out_len1,
                            reinterpret_cast<const unsigned char*>(input), size);
-    if (rc != 1) return false;
+    if (rc != 1) return -1;
 
-    int out_len2 = output.size() - out_len1;
-    rc = EVP_EncryptFinal_ex(ctx.get(), reinterpret_cast<unsigned char*>(output.data()) + out_len1, &out_len2);
-    if (rc != 1) return false;
+    int out_len2 = capacity - out_len1;
+    rc = EVP_EncryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(output) + out_len1, &out_len2);
+    if (rc != 1) return -1;
 
-    output.resize(out_len1 + out_len2);
-    return true;
+    return out_len1 + out_len2;
 }
 
-bool OpenSslWrapper::decrypt(const char *input, int size, QByteArray &output)
+int OpenSslWrapper::decrypt(const char *input, int size, char *output, int capacity)
 {
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&::EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), ::EVP_CIPHER_CTX_free);
+    if (capacity < size || !_keyed) return -1;
 
-    int rc = EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL,
-                            reinterpret_cast<const unsigned char*>(_key.constData()),
-                            reinterpret_cast<const unsigned char*>(_iv.constData()));
-    if (rc != 1) return false;
+    EVP_CIPHER_CTX *ctx = _decryptContext.get();
 
-    output.resize(size);
-    int out_len1 = output.size();
+    int rc = EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, reinterpret_cast<const unsigned char*>(_iv.constData()));
+    if (rc != 1) return -1;
 
-    rc = EVP_DecryptUpdate(ctx.get(), reinterpret_cast<unsigned char*>(output.data()), &out_len1,
+    int out_len1 = capacity;
+
+    rc = EVP_DecryptUpdate(ctx, reinterpret_cast<unsigned char*>(output), &out_len1,
                            reinterpret_cast<const unsigned char*>(input), size);
-    if (rc != 1) return false;
+    if (rc != 1) return -1;
 
-    int out_len2 = output.size() - out_len1;
-    rc = EVP_DecryptFinal_ex(ctx.get(), reinterpret_cast<unsigned char*>(output.data()) + out_len1, &out_len2);
-    if (rc != 1) return false;
+    int out_len2 = capacity - out_len1;
+    rc = EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(output) + out_len1, &out_len2);
+    if (rc != 1) return -1;
 
-    output.resize(out_len1 + out_len2);
-    return true;
+    return out_len1 + out_len2;
+}
+
+int OpenSslWrapper::encryptedSize(int size)
+{
+    return size + BLOCK_SIZE;
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <QObject>
+#include <memory>
+
+struct evp_cipher_ctx_st;
 
 class OpenSslWrapper
 {
@@ -9,7 +12,21 @@ public:
     bool encrypt(const char* input, int size, QByteArray &output);
     bool decrypt(const char* input, int size, QByteArray &output);
 
+    // write into caller owned buffers, return the output size or -1
+    int encrypt(const char* input, int size, char *output, int capacity);
+    int decrypt(const char* input, int size, char *output, int capacity);
+
+    static int encryptedSize(int size);
+
 private:
+    struct ContextDeleter
+    {
+        void operator()(evp_cipher_ctx_st *context) const;
+    };
+
     QByteArray _key, _iv;
+    // keyed once, a message only restarts the chain from the iv
+    std::unique_ptr<evp_cipher_ctx_st, ContextDeleter> _encryptContext, _decryptContext;
+    bool _keyed = false;
 };
 
@@ -0,0 +1,47 @@
+#include <QReadWriteLock>
+#include <QVector>
+#include <QHash>
+
+#include "devicetable.h"
+
+static QReadWriteLock lock;
+static QVector<QUuid> uuids;
+static QHash<QUuid, int> handles;
+
+int DeviceTable::allocate(const QUuid &uuid)
+{
+    if (uuid.isNull())
+        return INVALID_HANDLE;
+
+    QWriteLocker locker(&lock);
+
+    auto it = handles.constFind(uuid);
+    if (it != handles.constEnd())
+        return it.value();
+
+    const int result = uuids.size();
+    uuids.append(uuid);
+    handles.insert(uuid, result);
+    return result;
+}
+
+int DeviceTable::handle(const QUuid &uuid)
+{
+    if (uuid.isNull())
+        return INVALID_HANDLE;
+
+    QReadLocker locker(&lock);
+    return handles.value(uuid, INVALID_HANDLE);
+}
+
+QUuid DeviceTable::uuid(int handle)
+{
+    QReadLocker locker(&lock);
+    return handle >= 0 && handle < uuids.size() ? uuids.at(handle) : QUuid();
+}
+
+int DeviceTable::size()
+{
+    QReadLocker locker(&lock);
+    return uuids.size();
+}
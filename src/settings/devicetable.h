@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QUuid>
+
+// session local registry of small integer handles, uuids are kept for persistence and discovery.
+// handles are never reused while the process runs, so they can index flat vectors
+class DeviceTable
+{
+public:
+    static const int INVALID_HANDLE = -1;
+
+    // only the handshake and the configured devices add entries,
+    // uuids that merely appear in messages are looked up
+    static int allocate(const QUuid &uuid);
+    static int handle(const QUuid &uuid);
+    static QUuid uuid(int handle);
+    static int size();
+
+private:
+    DeviceTable() = delete;
+};
@@ -1,8 +1,10 @@
 #include <QGuiApplication>
 #include <QHostInfo>
+#include <QtNumeric>
 #include <QScreen>
 #include <QDebug>
 #include "settingsfacade.h"
+#include "devicetable.h"
 #include "utils.h"
 
 SettingsFacade &SettingsFacade::instance()
@@ -45,6 +47,12 @@ QVector<SharedCursor::Screen> SettingsFacade::screens()
         SharedCursor::Screen sharedScreen;
         sharedScreen.rect = screen->geometry();
         sharedScreen.enabled = true;
+
+        // geometry is in device independent pixels, so is the density
+        const qreal dpi = screen->physicalDotsPerInch();
+        if (qIsFinite(dpi) && dpi > 0)
+            sharedScreen.dpi = qRound(dpi);
+
         result.append(sharedScreen);
     }
 
@@ -149,7 +157,21 @@ void SettingsFacade::setDevice(const QJsonObject &obj)
         return;
 
     if (_devices.contains(uuid)) {
-        fillDeviceProperties(_devices[uuid], obj);
+        QSharedPointer<SharedCursor::Device> device = _devices.value(uuid);
+        const quint32 layoutHash = device->layoutHash;
+        fillDeviceProperties(device, obj);
+
+        if (obj.contains(SharedCursor::KEY_SCREENS)) {
+            if (device->layoutHash != layoutHash) {
+                emit deviceScreensChanged(uuid);
+                publishTopology();
+            }
+        }
+        else if (obj.contains(SharedCursor::KEY_LAYOUT_HASH)) {
+            // discovery only carries the hash, screens are requested over tcp
+            if (static_cast<quint32>(obj.value(SharedCursor::KEY_LAYOUT_HASH).toDouble()) != layoutHash)
+                emit deviceLayoutOutdated(uuid);
+        }
     }
     else {
         QSharedPointer<SharedCursor::Device> device = jsonObjectToDevicePtr(obj);
@@ -218,6 +240,41 @@ void SettingsFacade::setScreenEnabled(const QUuid &uuid, int index, bool enabled
     }
 }
 
+void SettingsFacade::publishTopology()
+{
+    QSharedPointer<SharedCursor::Topology> topology(new SharedCursor::Topology);
+    topology->version = ++_topologyVersion;
+
+    // devices are ordered by uuid, the snapshot is searched by it
+    for (auto it = _devices.constBegin(); it != _devices.constEnd(); ++it) {
+        const QSharedPointer<SharedCursor::Device> &device = it.value();
+        if (device.isNull())
+            continue;
+
+        SharedCursor::Topology::Entry entry;
+        entry.uuid = it.key();
+        entry.handle = DeviceTable::allocate(it.key());
+        entry.firstScreen = topology->screens.size();
+        entry.screenCount = device->screens.size();
+        entry.firstTransit = topology->transits.size();
+        entry.transitCount = device->transits.size();
+
+        topology->devices.append(entry);
+        topology->screens.append(device->screens);
+        topology->transits.append(device->transits);
+
+        while (topology->indexByHandle.size() <= entry.handle)
+            topology->indexByHandle.append(-1);
+        topology->indexByHandle[entry.handle] = topology->devices.size() - 1;
+    }
+
+    for (SharedCursor::Transit &transit: topology->transits) {
+        transit.handle = DeviceTable::allocate(transit.uuid);
+    }
+
+    emit topologyChanged(topology);
+}
+
 void SettingsFacade::setValue(const char *key, const QJsonValue &value)
 {
     _loader.setValue(key, value);
@@ -307,7 +364,14 @@ void SettingsFacade::fillDeviceProperties(QSharedPointer<SharedCursor::Device> d
     }
 
     if (obj.contains(SharedCursor::KEY_SCREENS)) {
-        device->screens = SharedCursor::jsonValueToScreensList(obj.value(SharedCursor::KEY_SCREENS));
+        const QVector<SharedCursor::Screen> &screens = SharedCursor::jsonValueToScreensList(obj.value(SharedCursor::KEY_SCREENS));
+        const quint32 layoutHash = SharedCursor::screenListHash(screens);
+
+        // keep enabled flags when the peer reports the same layout
+        if (layoutHash != device->layoutHash || device->screens.isEmpty()) {
+            device->screens = screens;
+            device->layoutHash = layoutHash;
+        }
     }
 
     if (obj.contains(SharedCursor::KEY_POSITION)) {
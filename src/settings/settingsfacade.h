@@ -44,6 +44,7 @@ public slots:
     void addTransitsToDevice(const QUuid &uuid, const QVector<SharedCursor::Transit> &transits);
 
     void setScreenEnabled(const QUuid &uuid, int index, bool enabled);
+    void publishTopology();
 
     void setDevice(const QJsonObject &obj);
     void removeDevice(const QUuid &uuid);
@@ -53,6 +54,9 @@ public slots:
 
 signals:
     void deviceFound(const QUuid &uuid, const QHostAddress &host);
+    void deviceLayoutOutdated(const QUuid &uuid);
+    void deviceScreensChanged(const QUuid &uuid);
+    void topologyChanged(const SharedCursor::TopologySnapshot &topology);
 
 
 private:
@@ -64,6 +68,8 @@ private:
     quint16 _portTcp = SharedCursor::DEFAULT_TCP_PORT;
     quint16 _portUdp = SharedCursor::DEFAULT_UDP_PORT;
     QMap<QUuid, QSharedPointer<SharedCursor::Device>> _devices;
+    // snapshots only leave through topologyChanged, readers keep their own reference
+    quint64 _topologyVersion = 0;
 
     void saveDevices();
     void saveSelfDevice();
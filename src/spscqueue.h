@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <array>
+
+// fixed capacity queue between exactly one producer and one consumer thread.
+// the storage is part of the object, push and pop never allocate
+template <typename T, int SIZE>
+class SpscQueue
+{
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "the size must be a power of two");
+
+public:
+    // producer thread only, false when full
+    bool push(const T &item)
+    {
+        const quint32 tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == quint32(SIZE))
+            return false;
+
+        _items[tail & (SIZE - 1)] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only, false when empty
+    bool pop(T &item)
+    {
+        const quint32 head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return false;
+
+        item = _items[head & (SIZE - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, SIZE> _items;
+    // the indices only grow, on separate cache lines so both sides do not contend
+    alignas(64) std::atomic<quint32> _head{0};
+    alignas(64) std::atomic<quint32> _tail{0};
+};
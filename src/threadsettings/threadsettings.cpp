@@ -0,0 +1,71 @@
+#include <QJsonArray>
+#include <QStringList>
+
+#include "threadsettings.h"
+#include "global.h"
+
+static const QVector<QPair<QString, QThread::Priority>> PRIORITY_NAMES = {
+    { "idle", QThread::IdlePriority },
+    { "lowest", QThread::LowestPriority },
+    { "low", QThread::LowPriority },
+    { "normal", QThread::NormalPriority },
+    { "high", QThread::HighPriority },
+    { "highest", QThread::HighestPriority },
+    { "timeCritical", QThread::TimeCriticalPriority }
+};
+
+void ThreadSettings::load(const QJsonObject &obj)
+{
+    const QString &priority = obj.value(SharedCursor::KEY_PRIORITY).toString();
+    for (const auto &pair: PRIORITY_NAMES) {
+        if (pair.first == priority)
+            _priority = pair.second;
+    }
+
+    const QString &policy = obj.value(SharedCursor::KEY_POLICY).toString();
+    if (policy == "fifo") _policy = FifoPolicy;
+    else if (policy == "rr") _policy = RoundRobinPolicy;
+    else _policy = DefaultPolicy;
+
+    _realtimePriority = obj.value(SharedCursor::KEY_REALTIME_PRIORITY).toInt(1);
+
+    _cpus.clear();
+    const QJsonArray &cpus = obj.value(SharedCursor::KEY_CPUS).toArray();
+    for (const QJsonValue &cpu: cpus) {
+        if (cpu.toInt(-1) >= 0)
+            _cpus.append(cpu.toInt());
+    }
+}
+
+QString ThreadSettings::apply() const
+{
+    QStringList report;
+
+    if (_priority != QThread::InheritPriority) {
+        QThread::currentThread()->setPriority(_priority);
+
+        for (const auto &pair: PRIORITY_NAMES) {
+            if (pair.second == _priority)
+                report << QString("priority %1").arg(pair.first);
+        }
+    }
+
+    QString error;
+
+    if (_policy != DefaultPolicy) {
+        const QString name = QString("policy %1 %2").arg(_policy == FifoPolicy ? "fifo" : "rr").arg(_realtimePriority);
+        report << (applyPolicy(error) ? name : QString("%1 failed: %2").arg(name, error));
+    }
+
+    if (!_cpus.isEmpty()) {
+        QStringList cpus;
+        for (int cpu: _cpus) {
+            cpus << QString::number(cpu);
+        }
+
+        const QString name = QString("cpus %1").arg(cpus.join(','));
+        report << (applyAffinity(error) ? name : QString("%1 failed: %2").arg(name, error));
+    }
+
+    return report.isEmpty() ? QString("defaults") : report.join(", ");
+}
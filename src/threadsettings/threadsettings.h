@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QVector>
+#include <QThread>
+
+class ThreadSettings
+{
+public:
+    enum Policy {
+        DefaultPolicy = 0,
+        FifoPolicy,
+        RoundRobinPolicy
+    };
+
+    void load(const QJsonObject &obj);
+
+    // applies to the calling thread, returns what was applied for the startup report
+    QString apply() const;
+
+private:
+    QThread::Priority _priority = QThread::InheritPriority;
+    Policy _policy = DefaultPolicy;
+    int _realtimePriority = 1;
+    QVector<int> _cpus;
+
+    bool applyPolicy(QString &error) const;
+    bool applyAffinity(QString &error) const;
+};
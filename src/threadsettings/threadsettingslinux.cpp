@@ -0,0 +1,45 @@
+#include <QtGlobal>
+#if defined(Q_OS_LINUX)
+
+#include "threadsettings.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <sched.h>
+
+bool ThreadSettings::applyPolicy(QString &error) const
+{
+    const int policy = _policy == FifoPolicy ? SCHED_FIFO : SCHED_RR;
+
+    sched_param param;
+    param.sched_priority = qBound(sched_get_priority_min(policy), _realtimePriority, sched_get_priority_max(policy));
+
+    // needs CAP_SYS_NICE or an rtprio limit in limits.conf
+    const int result = pthread_setschedparam(pthread_self(), policy, &param);
+    if (result != 0) {
+        error = QString::fromLocal8Bit(strerror(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool ThreadSettings::applyAffinity(QString &error) const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (int cpu: _cpus) {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        error = QString::fromLocal8Bit(strerror(result));
+        return false;
+    }
+
+    return true;
+}
+#endif
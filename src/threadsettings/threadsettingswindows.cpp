@@ -0,0 +1,35 @@
+#include <QtGlobal>
+#if defined(Q_OS_WIN)
+
+#include "threadsettings.h"
+
+#include "windows.h"
+
+bool ThreadSettings::applyPolicy(QString &error) const
+{
+    // windows has no realtime policies for threads, the closest is time critical
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        error = QString("error %1").arg(GetLastError());
+        return false;
+    }
+
+    return true;
+}
+
+bool ThreadSettings::applyAffinity(QString &error) const
+{
+    DWORD_PTR mask = 0;
+
+    for (int cpu: _cpus) {
+        if (cpu < int(sizeof(DWORD_PTR) * 8))
+            mask |= DWORD_PTR(1) << cpu;
+    }
+
+    if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        error = QString("error %1").arg(GetLastError());
+        return false;
+    }
+
+    return true;
+}
+#endif
@@ -2,9 +2,11 @@
 
 #include <QCryptographicHash>
 #include <QJsonDocument>
+#include <QDataStream>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include <QtEndian>
 #include <QObject>
 #include <QRect>
 #include <QFile>
@@ -42,6 +44,19 @@ inline QPoint jsonValueToPoint(const QJsonValue &jValue)
     return QPoint(obj.value("x").toInt(), obj.value("y").toInt());
 }
 
+inline QPoint pointToSubpixel(const QPointF &point)
+{
+    return QPoint(qRound(point.x() * SUBPIXEL_SCALE), qRound(point.y() * SUBPIXEL_SCALE));
+}
+
+inline QPoint takeWholePixels(QPoint &subpixel)
+{
+    // truncates toward zero, the fraction stays in the accumulator with its sign
+    const QPoint result(subpixel.x() / SUBPIXEL_SCALE, subpixel.y() / SUBPIXEL_SCALE);
+    subpixel -= result * SUBPIXEL_SCALE;
+    return result;
+}
+
 inline QJsonValue screenListToJsonValue(const QVector<SharedCursor::Screen> &rectList)
 {
     QJsonArray result;
@@ -52,6 +67,7 @@ inline QJsonValue screenListToJsonValue(const QVector<SharedCursor::Screen> &rec
         rectObj.insert("width", screen.rect.width());
         rectObj.insert("height", screen.rect.height());
         rectObj.insert("enable", screen.enabled);
+        rectObj.insert("dpi", screen.dpi);
         result.append(rectObj);
     }
     return result;
@@ -69,12 +85,29 @@ inline QVector<SharedCursor::Screen> jsonValueToScreensList(const QJsonValue &jV
                             obj.value("width").toInt(),
                             obj.value("height").toInt());
         screen.enabled = obj.value("enable").toBool(true);
+        screen.dpi = obj.value("dpi").toInt(SharedCursor::DEFAULT_DPI);
+        if (screen.dpi <= 0)
+            screen.dpi = SharedCursor::DEFAULT_DPI;
         result.append(screen);
     }
 
     return result;
 }
 
+inline quint32 screenListHash(const QVector<SharedCursor::Screen> &rectList)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    for (const SharedCursor::Screen &screen: rectList) {
+        stream << qint32(screen.rect.x()) << qint32(screen.rect.y())
+               << qint32(screen.rect.width()) << qint32(screen.rect.height())
+               << qint32(screen.dpi);
+    }
+
+    const QByteArray result = QCryptographicHash::hash(data, QCryptographicHash::Md5);
+    return qFromBigEndian<quint32>(result.constData());
+}
+
 inline QJsonValue transitListToJsonValue(const QVector<SharedCursor::Transit> &list)
 {
     QJsonArray result;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <atomic>
+
+class QSocketNotifier;
+class QWinEventNotifier;
+
+// wakes the thread the notifier lives in from any other thread without posting an event,
+// wakeups before that thread gets to run are folded into one activated signal
+class WakeupNotifier : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WakeupNotifier(QObject *parent = nullptr);
+    ~WakeupNotifier();
+
+    // on the thread that receives activated
+    bool start();
+    void stop();
+
+    // thread safe, does not allocate. false before start, the caller has to post an event then
+    bool wakeUp();
+
+signals:
+    void activated();
+
+private:
+    std::atomic<bool> _pending{false};
+
+#if defined(Q_OS_LINUX)
+    std::atomic<int> _fd{-1};
+    QSocketNotifier *_notifier = nullptr;
+#elif defined(Q_OS_WIN)
+    std::atomic<void*> _event{nullptr};
+    QWinEventNotifier *_notifier = nullptr;
+#endif
+
+    void onActivated();
+};
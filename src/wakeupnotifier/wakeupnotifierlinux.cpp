@@ -0,0 +1,79 @@
+#include <QtGlobal>
+#if defined(Q_OS_LINUX)
+
+#include <QSocketNotifier>
+#include <QDebug>
+#include "wakeupnotifier.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+WakeupNotifier::WakeupNotifier(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+WakeupNotifier::~WakeupNotifier()
+{
+    stop();
+}
+
+bool WakeupNotifier::start()
+{
+    if (_notifier)
+        return true;
+
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        qDebug() << Q_FUNC_INFO << "Error: Unable to create eventfd";
+        return false;
+    }
+
+    _notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(_notifier, &QSocketNotifier::activated, this, &WakeupNotifier::onActivated);
+    _pending = false;
+    _fd = fd;
+
+    return true;
+}
+
+void WakeupNotifier::stop()
+{
+    if (_notifier) {
+        _notifier->setEnabled(false);
+        delete _notifier;
+        _notifier = nullptr;
+    }
+
+    const int fd = _fd.exchange(-1);
+    if (fd >= 0)
+        close(fd);
+}
+
+bool WakeupNotifier::wakeUp()
+{
+    const int fd = _fd;
+    if (fd < 0)
+        return false;
+
+    if (_pending.exchange(true))
+        return true;
+
+    const quint64 value = 1;
+    return write(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+void WakeupNotifier::onActivated()
+{
+    // resets the counter, nothing to read is fine as well
+    quint64 value = 0;
+    const ssize_t size = read(_fd, &value, sizeof(value));
+    Q_UNUSED(size);
+
+    // cleared before the signal, a wakeup during the handlers is not lost
+    _pending = false;
+    emit activated();
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include <QtGlobal>
+#if defined(Q_OS_WIN)
+
+#include <QWinEventNotifier>
+#include <QDebug>
+#include "wakeupnotifier.h"
+
+#include "windows.h"
+
+WakeupNotifier::WakeupNotifier(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+WakeupNotifier::~WakeupNotifier()
+{
+    stop();
+}
+
+bool WakeupNotifier::start()
+{
+    if (_notifier)
+        return true;
+
+    // auto reset, the wait that reports it also rearms it
+    HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!event) {
+        qDebug() << Q_FUNC_INFO << "Error: Unable to create event" << GetLastError();
+        return false;
+    }
+
+    _notifier = new QWinEventNotifier(event, this);
+    connect(_notifier, &QWinEventNotifier::activated, this, &WakeupNotifier::onActivated);
+    _pending = false;
+    _event = event;
+
+    return true;
+}
+
+void WakeupNotifier::stop()
+{
+    if (_notifier) {
+        _notifier->setEnabled(false);
+        delete _notifier;
+        _notifier = nullptr;
+    }
+
+    void *event = _event.exchange(nullptr);
+    if (event)
+        CloseHandle(event);
+}
+
+bool WakeupNotifier::wakeUp()
+{
+    void *event = _event;
+    if (!event)
+        return false;
+
+    if (_pending.exchange(true))
+        return true;
+
+    return SetEvent(event) != 0;
+}
+
+void WakeupNotifier::onActivated()
+{
+    // cleared before the signal, a wakeup during the handlers is not lost
+    _pending = false;
+    emit activated();
+}
+
+#endif
@@ -88,6 +88,17 @@ void SettingsWidget::setDeviceConnectionState(const QUuid &uuid, SharedCursor::C
     }
 }
 
+void SettingsWidget::updateDeviceScreens(const QUuid &uuid)
+{
+    qDebug() << Q_FUNC_INFO << uuid;
+
+    if (!_deviceWidgets.contains(uuid))
+        return;
+
+    _positioningWidget->removeDevice(uuid);
+    _positioningWidget->addDevice(Settings.device(uuid));
+}
+
 void SettingsWidget::createFoundDeviceWidget(QSharedPointer<SharedCursor::Device> device)
 {
     if (device.isNull())
@@ -164,13 +175,13 @@ void SettingsWidget::saveSettings()
         Settings.setScreenEnabled(item->uuid(), item->index(), item->isEnabled());
     }
 
-    emit devicesChanged(Settings.devices());
-
     for (const QUuid &uuid: std::as_const(_removeList)) {
         Settings.removeDevice(uuid);
         emit removeDevice(uuid);
     }
 
+    Settings.publishTopology();
+
     Settings.save();
 }
 
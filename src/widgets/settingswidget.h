@@ -27,6 +27,7 @@ public:
 
 public slots:
     void setDeviceConnectionState(const QUuid &uuid, SharedCursor::ConnectionState state);
+    void updateDeviceScreens(const QUuid &uuid);
 
 signals:
     void findDevices();
@@ -34,7 +35,6 @@ signals:
     void keywordChanged(const QString &key);
     void removeDevice(const QUuid &uuid);
     void screenPositionChanged(const QUuid &uuid, const QPoint &pos);
-    void devicesChanged(const QMap<QUuid, QSharedPointer<SharedCursor::Device>> &devices);
 
 private:
     Ui::SettingsWidget *ui;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QThread>
+#include <QFile>
+
+// a private Xvfb for tests and benchmarks, DISPLAY points to it while it runs
+class XvfbServer
+{
+public:
+    ~XvfbServer()
+    {
+        stop();
+    }
+
+    bool start(const QString &geometry = QStringLiteral("1920x1080x24"))
+    {
+        const QString program = QStandardPaths::findExecutable(QStringLiteral("Xvfb"));
+        if (program.isEmpty())
+            return false;
+
+        // the first free display number, the lock file is created by the server itself
+        for (int number=90; number<110; ++number) {
+            if (QFile::exists(QStringLiteral("/tmp/.X%1-lock").arg(number)))
+                continue;
+
+            _process.start(program, {QStringLiteral(":%1").arg(number), QStringLiteral("-screen"), QStringLiteral("0"), geometry,
+                                     QStringLiteral("-nolisten"), QStringLiteral("tcp")});
+            if (!_process.waitForStarted())
+                return false;
+
+            const QString socket = QStringLiteral("/tmp/.X11-unix/X%1").arg(number);
+            QElapsedTimer timer;
+            timer.start();
+
+            while (timer.elapsed() < 5000 && _process.state() == QProcess::Running) {
+                if (QFile::exists(socket)) {
+                    _previousDisplay = qgetenv("DISPLAY");
+                    _displaySet = true;
+                    qputenv("DISPLAY", QStringLiteral(":%1").arg(number).toLocal8Bit());
+                    return true;
+                }
+                QThread::msleep(10);
+            }
+
+            stop();
+        }
+
+        return false;
+    }
+
+    void stop()
+    {
+        if (_displaySet) {
+            qputenv("DISPLAY", _previousDisplay);
+            _displaySet = false;
+        }
+
+        if (_process.state() == QProcess::NotRunning)
+            return;
+
+        _process.terminate();
+        if (!_process.waitForFinished(3000))
+            _process.kill();
+    }
+
+private:
+    QProcess _process;
+    QByteArray _previousDisplay;
+    bool _displaySet = false;
+};
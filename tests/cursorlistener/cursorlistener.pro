@@ -0,0 +1,24 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += c++17
+CONFIG += console testcase
+
+TEMPLATE = app
+TARGET = tst_cursorlistener
+
+INCLUDEPATH += \
+    ../common \
+    ../../src/input/cursorlistener
+
+SOURCES += \
+    tst_cursorlistener.cpp \
+    ../../src/input/cursorlistener/cursorlistenerlinux.cpp
+
+HEADERS += \
+    ../common/xvfbserver.h \
+    ../../src/input/cursorlistener/cursorlistener.h
+
+linux:!android {
+    LIBS += -lX11 -lXtst -lXi -lXfixes
+}
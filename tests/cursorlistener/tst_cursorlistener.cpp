@@ -0,0 +1,125 @@
+#include <QSignalSpy>
+#include <QtTest>
+
+#include "cursorlistener.h"
+#include "xvfbserver.h"
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+// xlib macros clash with the generated moc code
+#undef Bool
+#undef Status
+
+// the listener reads the events of the whole server, the pointer is driven from a second connection
+class TestCursorListener : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void motionEmitsCursorMoved();
+    void motionDisabledIsSilent();
+    void barrierEmitsHit();
+
+private:
+    XvfbServer _xvfb;
+    Display *_display = nullptr;
+    CursorListener *_listener = nullptr;
+
+    void moveTo(int x, int y);
+    void moveBy(int dx, int dy);
+};
+
+void TestCursorListener::initTestCase()
+{
+    if (!_xvfb.start())
+        QSKIP("Xvfb is not available");
+
+    _display = XOpenDisplay(nullptr);
+    QVERIFY(_display);
+
+    int event = 0, error = 0, major = 0, minor = 0;
+    QVERIFY(XTestQueryExtension(_display, &event, &error, &major, &minor));
+}
+
+void TestCursorListener::cleanupTestCase()
+{
+    if (_display)
+        XCloseDisplay(_display);
+
+    _xvfb.stop();
+}
+
+void TestCursorListener::init()
+{
+    _listener = new CursorListener;
+    QVERIFY(_listener->start());
+    QVERIFY(_listener->isActive());
+
+    moveTo(100, 100);
+    QTest::qWait(50);
+}
+
+void TestCursorListener::cleanup()
+{
+    delete _listener;
+    _listener = nullptr;
+}
+
+void TestCursorListener::motionEmitsCursorMoved()
+{
+    QSignalSpy moved(_listener, &CursorListener::cursorMoved);
+
+    moveTo(300, 200);
+
+    QTRY_VERIFY(moved.count() > 0);
+}
+
+void TestCursorListener::motionDisabledIsSilent()
+{
+    _listener->setMotionEnabled(false);
+    QSignalSpy moved(_listener, &CursorListener::cursorMoved);
+
+    moveTo(300, 200);
+    QTest::qWait(200);
+
+    QCOMPARE(moved.count(), 0);
+}
+
+void TestCursorListener::barrierEmitsHit()
+{
+    // the right edge of a 640 pixel wide screen area leads to another device
+    if (!_listener->setBarriers({{QLine(639, 0, 639, 1079), 1}}))
+        QSKIP("pointer barriers are not supported by this server");
+
+    QSignalSpy hit(_listener, &CursorListener::barrierHit);
+
+    moveTo(600, 500);
+    for (int i=0; i<10; ++i) {
+        moveBy(20, 0);
+    }
+
+    QTRY_VERIFY(hit.count() > 0);
+    QCOMPARE(hit.first().at(0).toInt(), 0);
+    QVERIFY(hit.first().at(1).toPoint().x() <= 639);
+}
+
+void TestCursorListener::moveTo(int x, int y)
+{
+    XTestFakeMotionEvent(_display, -1, x, y, CurrentTime);
+    XFlush(_display);
+}
+
+void TestCursorListener::moveBy(int dx, int dy)
+{
+    XTestFakeRelativeMotionEvent(_display, dx, dy, CurrentTime);
+    XFlush(_display);
+}
+
+QTEST_GUILESS_MAIN(TestCursorListener)
+
+#include "tst_cursorlistener.moc"